@@ -46,9 +46,27 @@
  */
 #define MAX_NUMBER_OF_PROCESSES 8
 
+//! Let REGISTER_AUTOSTART place its descriptors in program memory, see REGISTER_AUTOSTART_FLASH
+#ifndef OS_AUTOSTART_FLASH
+#define OS_AUTOSTART_FLASH 0
+#endif
+
 //! Standard priority for newly created processes
 #define DEFAULT_PRIORITY 2
 
+/*!
+ *  Boot without the pauses that only give the user time to read the boot
+ *  messages, and let the LCD initialization wait the datasheet minimum instead
+ *  of fixed worst-case delays. Continuous integration builds boot fast by default.
+ */
+#ifndef OS_FAST_BOOT
+#if defined(CONTINOUS_INTEGRATION) && CONTINOUS_INTEGRATION
+#define OS_FAST_BOOT 1
+#else
+#define OS_FAST_BOOT 0
+#endif
+#endif
+
 //! Default delay to read display values (in ms)
 #ifndef DEFAULT_OUTPUT_DELAY
 #define DEFAULT_OUTPUT_DELAY 100
@@ -61,6 +79,12 @@
 //! Number to specify an invalid process
 #define INVALID_PROCESS 255
 
+//! Timer 2 compare value of a regular time slice (approx. 3 ms)
+#define SCHEDULER_TICK 60
+
+//! Timer 2 compare value used while only the idle process is ready (approx. 13 ms)
+#define SCHEDULER_IDLE_TICK 255
+
 //----------------------------------------------------------------------------
 // Stack constants
 //----------------------------------------------------------------------------
@@ -71,9 +95,120 @@
 //! The scheduler's stack size
 #define STACK_SIZE_ISR 192
 
-//! The stack size of a process
+//! The default stack size of a process
 #define STACK_SIZE_PROC (((AVR_MEMORY_SRAM / 2) - STACK_SIZE_MAIN - STACK_SIZE_ISR) / MAX_NUMBER_OF_PROCESSES)
 
+//! The smallest stack size a process may request, its initial context alone takes 35 bytes
+#define STACK_SIZE_PROC_MIN 64
+
+//! The stack size of the idle process
+#define STACK_SIZE_IDLE 128
+
+//! Byte every process stack is filled with by os_exec, see os_getStackHighWater
+#define STACK_PAINT 0xAA
+
+//! Stack check: XOR checksum over the whole used stack on every context switch
+#define OS_STACK_CHECK_FULL 0
+
+//! Stack check: checksum over the saved context plus STACK_CHECK_WINDOW bytes, the idle process checks the rest
+#define OS_STACK_CHECK_WINDOW 1
+
+//! Stack check: guard word at the top of every stack, only detects overflows
+#define OS_STACK_CHECK_CANARY 2
+
+//! The active stack check, one of the OS_STACK_CHECK_* values
+#ifndef OS_STACK_CHECK
+#define OS_STACK_CHECK OS_STACK_CHECK_FULL
+#endif
+
+//! Bytes below the saved context covered by the checksum if OS_STACK_CHECK is OS_STACK_CHECK_WINDOW
+#define STACK_CHECK_WINDOW 32
+
+//! Guard word written to the top of every stack if OS_STACK_CHECK is OS_STACK_CHECK_CANARY
+#define STACK_CANARY 0xC0DE
+
+//! Measure how long critical sections and ATOMIC blocks hold off the scheduler, see os_getCriticalStats
+#ifndef OS_CRITICAL_STATS
+#define OS_CRITICAL_STATS 0
+#endif
+
+/*!
+ *  Define OS_FIXED_STRATEGY as one of the OS_SS_* values (e.g. through
+ *  ADDITIONAL_CFLAGS="-DOS_FIXED_STRATEGY=OS_SS_ROUND_ROBIN") to build a kernel that
+ *  only knows this strategy. The dispatch is then folded into a single call, the
+ *  other strategies are dropped by the linker and the task manager cannot change
+ *  the strategy anymore.
+ */
+#ifdef OS_FIXED_STRATEGY
+#define OS_PRAGMA(X) _Pragma(#X)
+#define OS_UNROLL(N) OS_PRAGMA(GCC unroll N)
+#endif
+
+//! Unrolls a loop over all process slots in a fixed strategy build (needs GCC 8 or later)
+#if defined(OS_FIXED_STRATEGY) && __GNUC__ >= 8
+#define OS_UNROLL_PROCESSES OS_UNROLL(MAX_NUMBER_OF_PROCESSES)
+#else
+#define OS_UNROLL_PROCESSES
+#endif
+
+//! Let the random strategy draw from a xorshift generator instead of rand(), which the tests expect
+#ifndef OS_RANDOM_XORSHIFT
+#define OS_RANDOM_XORSHIFT 0
+#endif
+
+//! Run Timer 1 as a cycle counter for os_ticks(), programs that need Timer 1 for themselves may disable this
+#ifndef OS_TICKS
+#define OS_TICKS 1
+#endif
+
+//! Record context switches, process creation, critical sections and blocking in a trace buffer streamed over USART0, see os_trace.h
+#ifndef OS_TRACE
+#define OS_TRACE 0
+#endif
+
+//! Size of the trace buffer in bytes, a power of two of at most 256
+#define TRACE_BUFFER_SIZE 256
+
+//! Baud rate of the trace stream, 8N1
+#define TRACE_BAUD 115200ul
+
+//! The time of a trace record counts units of 2^TRACE_TIME_SHIFT cycles
+#define TRACE_TIME_SHIFT 4
+
+//! Compile the interrupt driven USART0 driver and its stream uartout, see os_uart.h
+#ifndef OS_UART
+#define OS_UART 0
+#endif
+
+//! Bind stdout to uartout instead of the LCD, errors still go to the LCD through stderr
+#ifndef OS_UART_STDOUT
+#define OS_UART_STDOUT 0
+#endif
+
+#if OS_UART_STDOUT && !OS_UART
+#error "OS_UART_STDOUT needs the driver, see OS_UART"
+#endif
+
+//! Baud rate of USART0, 8N1
+#define UART_BAUD 115200ul
+
+//! Size of the transmit buffer of USART0 in bytes, a power of two of at most 256
+#define UART_TX_BUFFER_SIZE 64
+
+//! Size of the receive buffer of USART0 in bytes, a power of two of at most 256
+#define UART_RX_BUFFER_SIZE 32
+
+//! Buckets of the hold time histogram, bucket b counts holds below 2^b Timer 0 counts, the last one all longer holds
+#define CRITICAL_HISTOGRAM_BUCKETS 10
+
+//! Let os_poolFree search the free list for the block, so freeing a block twice is reported instead of corrupting the pool
+#ifndef OS_POOL_CHECK
+#define OS_POOL_CHECK 1
+#endif
+
+//! Number of slots of the deferred call queue, a power of two of at most 256, one slot stays free
+#define DEFERRED_QUEUE_SIZE 8
+
 //! The bottom of the main stack. That is the highest address.
 #define BOTTOM_OF_MAIN_STACK (AVR_SRAM_LAST)
 
@@ -83,7 +218,14 @@
 //! The bottom of the memory chunks for all process stacks. That is the highest address.
 #define BOTTOM_OF_PROCS_STACK (BOTTOM_OF_ISR_STACK - STACK_SIZE_ISR)
 
-//! The bottom of the memory chunk with number PID.
+//! The top of the memory region that holds all process stacks. That is the lowest address.
+#define TOP_OF_PROCS_STACK (BOTTOM_OF_PROCS_STACK - MAX_NUMBER_OF_PROCESSES * STACK_SIZE_PROC + 1)
+
+/*!
+ *  The bottom of the memory chunk with number PID. Processes with a stack of
+ *  at most STACK_SIZE_PROC bytes are placed here whenever this chunk is free,
+ *  otherwise the stack is allocated elsewhere in the region (see os_exec).
+ */
 #define PROCESS_STACK_BOTTOM(PID) (BOTTOM_OF_PROCS_STACK - ((PID)*STACK_SIZE_PROC))
 
 
@@ -21,6 +21,7 @@
 #include <avr/interrupt.h>
 #include <avr/io.h>
 #include <stdio.h>
+#include <string.h>
 #include <util/atomic.h>
 #include <util/delay.h>
 
@@ -32,6 +33,37 @@
  */
 uint8_t charCtr;
 
+#if LCD_BUFFERED
+
+//! Ring buffer of port values, every byte for the LCD is queued as two nibbles
+static volatile uint8_t lcd_queue[LCD_QUEUE_SIZE];
+
+//! Index of the next free entry in lcd_queue
+static volatile uint8_t lcd_queueHead;
+
+//! Index of the next entry of lcd_queue to be sent
+static volatile uint8_t lcd_queueTail;
+
+//! Number of consecutive attempts the LCD was busy
+static uint16_t lcd_busyCount;
+
+/*!
+ *  Shadow of the display, row by row. Writes only change this buffer, the
+ *  Timer 0 compare match B interrupt sends the changed cells to the LCD.
+ */
+static char lcd_frame[32];
+
+//! Bit n of lcd_dirty[n / 8] is set iff cell n of lcd_frame has not been sent yet
+static volatile uint8_t lcd_dirty[4];
+
+//! Cell the address counter of the LCD points to, LCD_CURSOR_UNKNOWN after other commands
+static uint8_t lcd_cursor;
+
+//! Value of lcd_cursor if the address counter of the LCD is unknown
+#define LCD_CURSOR_UNKNOWN 0xFF
+
+#endif
+
 /*!
  *  Internally used to turn on LCD Pin EN (Enable) for 1us.
  *  \internal
@@ -49,9 +81,20 @@ static int lcd_writeWrapper(const char c, FILE *stream) {
 
 FILE *lcdout = &(FILE)FDEV_SETUP_STREAM(lcd_writeWrapper, NULL, _FDEV_SETUP_WRITE);
 
+/*!
+ *  Wait between the steps of the init routine, during which the busy flag cannot be read yet.
+ *  A fast boot waits the datasheet minimum, the default leaves plenty of reserve.
+ */
+#if OS_FAST_BOOT
+#define LCD_INIT_STEP_DELAY() _delay_us(100)
+#else
+#define LCD_INIT_STEP_DELAY() delayMs(1)
+#endif
+
 /*!
  *  Prepares the LCD to be used with the defined output-port.
- *  Delay times as specified with some reserve
+ *  Delay times as specified with some reserve. Once the LCD is in 4 bit mode,
+ *  every command polls the busy flag, so a fast boot continues right away.
  */
 void lcd_init(void) {
     // Write on LCD Port (reading is not needed)
@@ -63,14 +106,16 @@ void lcd_init(void) {
     lcd_enable();
     delayMs(5);
     lcd_enable();
-    delayMs(1);
+    LCD_INIT_STEP_DELAY();
     lcd_enable();
-    delayMs(1);
+    LCD_INIT_STEP_DELAY();
 
     // LCD is connected with 4 pins for data
     LCD_PORT_DATA = LCD_4BIT_MODE;
     lcd_enable();
+#if !OS_FAST_BOOT
     delayMs(1);
+#endif
 
     // Display type is 2 line / 5x7 character set
     lcd_command(LCD_TWO_LINES | LCD_5X7);
@@ -78,7 +123,7 @@ void lcd_init(void) {
 
     // Do not increment DDRAM address or move display
     lcd_command(LCD_NO_INC_ADDR | LCD_NO_MOVE);
-    lcd_clear();
+    lcd_command(LCD_CLEAR);
 
     // Register custom characters
     lcd_registerCustomChar(LCD_CC_IXI, LCD_CC_IXI_BITMAP);
@@ -86,14 +131,23 @@ void lcd_init(void) {
     lcd_registerCustomChar(LCD_CC_BACKSLASH, LCD_CC_BACKSLASH_BITMAP);
     lcd_registerCustomChar(LCD_CC_MU, LCD_CC_MU_BITMAP);
 
-    lcd_clear();
+    // Always clear the controller, the shadow frame only sends what changed
+    lcd_command(LCD_CLEAR);
+    charCtr = 0;
+#if LCD_BUFFERED
+    memset(lcd_frame, ' ', sizeof(lcd_frame));
+    memset((uint8_t *)lcd_dirty, 0, sizeof(lcd_dirty));
+    lcd_cursor = 0;
+#endif
 }
 
 /*!
  *  Moves the cursor to the first character of the first line of the LCD.
  */
 void lcd_line1(void) {
+#if !LCD_BUFFERED
     lcd_command(LCD_LINE_1);
+#endif
     charCtr = 0;
 }
 
@@ -101,7 +155,9 @@ void lcd_line1(void) {
  *  Moves the cursor to the first character of the second line of the LCD.
  */
 void lcd_line2(void) {
+#if !LCD_BUFFERED
     lcd_command(LCD_LINE_2);
+#endif
     charCtr = 16;
 }
 
@@ -153,19 +209,253 @@ void lcd_goto(unsigned char row, unsigned char column) {
         column = 0;
     }
 
-    // Calculate position and get command
-    char command = LCD_CURSOR_MOVE_R + column + row * LCD_NEXT_ROW;
-
     // Update char counter
     charCtr = row * 16 + column;
 
+#if !LCD_BUFFERED
+    // Calculate position and get command
+    char command = LCD_CURSOR_MOVE_R + column + row * LCD_NEXT_ROW;
+
     lcd_command(command);
+#endif
+}
+
+/*!
+ *  Reads the busy flag of the LCD. Afterwards the data pins are inputs.
+ *
+ *  \return True if the LCD is still working on the last command.
+ *  \internal
+ */
+static bool lcd_isBusy(void) {
+    // Read busy flag state:
+    // Set R/W port to high, all others to low
+    LCD_PORT_DATA = 0x40;
+
+    // Set enable port to high to read first nibble
+    sbi(LCD_PORT_DATA, 5);
+
+    // Enable reading from pins 1 to 4
+    LCD_PORT_DDR = 0xF0;
+
+    // Set pull-ups
+    LCD_PORT_DATA |= 0x0F;
+
+    // Read busy flag (port 4) and store state to 'busy'
+    const bool busy = LCD_PIN & 0x08;
+
+    // Set enable port back to low
+    cbi(LCD_PORT_DATA, 5);
+
+    // Second nibble is not used, waste it by calling lcd_enable
+    lcd_enable();
+
+    return busy;
+}
+
+#if LCD_BUFFERED
+
+/*!
+ *  Sends the next queued nibble to the LCD. The busy flag is only checked
+ *  before the first nibble of a pair, as the second one belongs to the same
+ *  transfer. If the LCD stays busy for LCD_BUSY_TIMEOUT attempts, the pair is
+ *  dropped just like lcd_sendStream does in synchronous mode.
+ *  Must be called with interrupts disabled and a non-empty queue.
+ *
+ *  \internal
+ */
+static void lcd_sendQueuedNibble(void) {
+    const uint8_t tail = lcd_queueTail;
+
+    if (!(tail & 1) && lcd_isBusy()) {
+        if (++lcd_busyCount == LCD_BUSY_TIMEOUT) {
+            // Timeout: Try to reset LCD
+            lcd_enable();
+            lcd_busyCount = 0;
+            lcd_queueTail = (tail + 2) % LCD_QUEUE_SIZE;
+        }
+        return;
+    }
+    lcd_busyCount = 0;
+
+    LCD_PORT_DDR = 0xFF;
+    LCD_PORT_DATA = lcd_queue[tail];
+    lcd_enable();
+
+    lcd_queueTail = (tail + 1) % LCD_QUEUE_SIZE;
+}
+
+/*!
+ *  Turns on the Timer 0 compare match B interrupt if it is not running yet.
+ *  Must be called with interrupts disabled.
+ *
+ *  \internal
+ */
+static void lcd_startDrain(void) {
+    if (!gbi(TIMSK0, OCIE0B)) {
+        OCR0B = TCNT0 + LCD_DRAIN_INTERVAL;
+        TIFR0 = (1 << OCF0B); // Clear a stale compare match
+        sbi(TIMSK0, OCIE0B);
+    }
+}
+
+/*!
+ *  Appends a pair of nibbles to the output queue and starts draining it.
+ *  If the queue is full, the oldest nibbles are sent right away to make room.
+ *
+ *  \param firstByte The first value to send.
+ *  \param secondByte The second value to send.
+ *  \internal
+ */
+static void lcd_enqueue(uint8_t firstByte, uint8_t secondByte) {
+    ATOMIC {
+        while ((uint8_t)(lcd_queueTail - lcd_queueHead - 1) % LCD_QUEUE_SIZE < 2) {
+            lcd_sendQueuedNibble();
+        }
+
+        const uint8_t head = lcd_queueHead;
+        lcd_queue[head] = firstByte;
+        lcd_queue[(head + 1) % LCD_QUEUE_SIZE] = secondByte;
+        lcd_queueHead = (head + 2) % LCD_QUEUE_SIZE;
+
+        lcd_startDrain();
+    }
+}
+
+/*!
+ *  Checks whether any cell of the shadow frame still has to be sent.
+ *
+ *  \return True if at least one cell is dirty.
+ *  \internal
+ */
+static bool lcd_isDirty(void) {
+    bool dirty;
+    ATOMIC {
+        dirty = lcd_dirty[0] | lcd_dirty[1] | lcd_dirty[2] | lcd_dirty[3];
+    }
+    return dirty;
+}
+
+/*!
+ *  Changes one cell of the shadow frame. The LCD is only updated if the
+ *  character actually differs from the one in the frame.
+ *  Must be called with interrupts disabled.
+ *
+ *  \param cell The cell to change (0...31).
+ *  \param character The character code for the LCD.
+ *  \internal
+ */
+static void lcd_setCell(uint8_t cell, char character) {
+    if (lcd_frame[cell] == character) {
+        return;
+    }
+    lcd_frame[cell] = character;
+    sbi(lcd_dirty[cell / 8], cell % 8);
+    lcd_startDrain();
+}
+
+/*!
+ *  Moves the next dirty cell of the shadow frame into the output queue.
+ *  Cells right behind the current cursor position are preferred, so runs of
+ *  changed cells only need a single cursor command.
+ *  Must be called with interrupts disabled.
+ *
+ *  \return False if there was no dirty cell.
+ *  \internal
+ */
+static bool lcd_queueDirtyCell(void) {
+    uint8_t cell = lcd_cursor < 32 ? lcd_cursor : 0;
+    uint8_t i = 32;
+
+    // Search cyclically, starting at the current cursor position
+    while (!gbi(lcd_dirty[cell / 8], cell % 8)) {
+        if (!--i) {
+            return false;
+        }
+        cell = (cell + 1) % 32;
+    }
+    cbi(lcd_dirty[cell / 8], cell % 8);
+
+    if (cell != lcd_cursor) {
+        const uint8_t command = LCD_CURSOR_MOVE_R + (cell % 16) + (cell / 16) * LCD_NEXT_ROW;
+        lcd_enqueue((command >> 4) & 0xF, command & 0xF);
+    }
+    const char character = lcd_frame[cell];
+    lcd_enqueue(0x10 | ((character & 0xF0) >> 4), 0x10 | (character & 0x0F));
+
+    // The address counter does not wrap from the end of line 1 to line 2
+    lcd_cursor = (cell % 16 == 15) ? LCD_CURSOR_UNKNOWN : cell + 1;
+    return true;
+}
+
+/*!
+ *  Drains the output queue one nibble at a time. Once it is empty, the next
+ *  dirty cell of the shadow frame is queued. Timer 0 keeps running in normal
+ *  mode for the system time, so the compare value is advanced by
+ *  LCD_DRAIN_INTERVAL to get the next interrupt. The interrupt is turned off
+ *  as soon as there is nothing left to send.
+ */
+ISR(TIMER0_COMPB_vect) {
+    if (lcd_queueHead == lcd_queueTail) {
+        lcd_queueDirtyCell();
+    }
+    if (lcd_queueHead != lcd_queueTail) {
+        lcd_sendQueuedNibble();
+    }
+
+    if (lcd_queueHead == lcd_queueTail && !lcd_isDirty()) {
+        cbi(TIMSK0, OCIE0B);
+    } else {
+        OCR0B += LCD_DRAIN_INTERVAL;
+    }
+}
+
+#endif
+
+/*!
+ *  Waits until the LCD shows the shadow frame and all queued commands have
+ *  been sent. If interrupts are disabled, this is done right here instead.
+ *  Code that writes with interrupts disabled and then waits (e.g. for user
+ *  input) has to call this, as nothing reaches the LCD until interrupts are
+ *  enabled again. Does nothing if LCD_BUFFERED is 0, as the output is always
+ *  sent immediately then.
+ */
+void lcd_flush(void) {
+#if LCD_BUFFERED
+    if (SREG & (1 << 7)) {
+        while (lcd_queueHead != lcd_queueTail || lcd_isDirty()) {
+            continue;
+        }
+        return;
+    }
+
+    do {
+        while (lcd_queueHead != lcd_queueTail) {
+            lcd_sendQueuedNibble();
+        }
+    } while (lcd_queueDirtyCell());
+#endif
+}
+
+/*!
+ *  Sends the shadow frame right away if interrupts are disabled, as nothing
+ *  drains it then. Called after whole strings, so code that reports with
+ *  interrupts disabled (e.g. the ATOMIC test macros) does not need lcd_flush.
+ */
+static void lcd_flushIfAtomic(void) {
+#if LCD_BUFFERED
+    if (!(SREG & (1 << 7))) {
+        lcd_flush();
+    }
+#endif
 }
 
 /*!
  *  Sends a stream to the LCD. The stream is a two-char pair which either
  *  holds a command or a printable char.
  *  This function is used by lcd_command and lcd_writeChar.
+ *  If LCD_BUFFERED is set and the caller runs with interrupts enabled, the
+ *  stream is only queued and sent in the background. Otherwise the pending
+ *  output is flushed and the stream is sent right away.
  *
  *  \param firstByte The first value to send.
  *  \param secondByte The second value to send.
@@ -174,35 +464,27 @@ void lcd_sendStream(uint8_t firstByte, uint8_t secondByte) {
     // Check if interrupts are set and store that state
     uint8_t sreg = SREG & (1 << 7);
 
+#if LCD_BUFFERED
+    if (sreg) {
+        ATOMIC {
+            // The stream may move the address counter
+            lcd_cursor = LCD_CURSOR_UNKNOWN;
+            lcd_enqueue(firstByte, secondByte);
+        }
+        return;
+    }
+
+    // Keep the order with output that is still pending
+    lcd_flush();
+    lcd_cursor = LCD_CURSOR_UNKNOWN;
+#endif
+
     // Interrupts off
     cli();
     uint16_t iterations = 0;
-    bool busy = false;
 
     // Wait while LCD is busy or timeout was reached
-    do {
-        // Read busy flag state:
-        // Set R/W port to high, all others to low
-        LCD_PORT_DATA = 0x40;
-
-        // Set enable port to high to read first nibble
-        sbi(LCD_PORT_DATA, 5);
-
-        // Enable reading from pins 1 to 4
-        LCD_PORT_DDR = 0xF0;
-
-        // Set pull-ups
-        LCD_PORT_DATA |= 0x0F;
-
-        // Read busy flag (port 4) and store state to 'busy'
-        busy = LCD_PIN & 0x08;
-
-        // Set enable port back to low
-        cbi(LCD_PORT_DATA, 5);
-
-        // Second nibble is not used, waste it by calling lcd_enable
-        lcd_enable();
-
+    while (lcd_isBusy()) {
         // Increase count of iterations
         iterations++;
         if (iterations == LCD_BUSY_TIMEOUT) {
@@ -213,7 +495,7 @@ void lcd_sendStream(uint8_t firstByte, uint8_t secondByte) {
             SREG |= sreg;
             return;
         }
-    } while (busy);
+    }
 
     // Transmit command:
     LCD_PORT_DDR = 0xFF;
@@ -245,6 +527,8 @@ void lcd_command(uint8_t command) {
 /*!
  *  Writes an 8-Bit UTF-8-like-value to the LCD.
  *  Supports automatic line breaks.
+ *  With LCD_BUFFERED, this only updates the shadow frame, so interrupts are
+ *  turned off for a few cycles instead of a whole transfer.
  *
  *  \param character  The character to be written.
  */
@@ -327,7 +611,11 @@ void lcd_writeChar(char character) {
         }
 #undef REMAP
 
+#if LCD_BUFFERED
+        lcd_setCell(charCtr, character);
+#else
         lcd_sendStream(0x10 | ((character & 0xF0) >> 4), 0x10 | (character & 0x0F));
+#endif
 
         // Update char counter ... Do not modulo it down! we need it to become 32
         charCtr++;
@@ -338,8 +626,18 @@ void lcd_writeChar(char character) {
  *  Erases the LCD and positions the cursor at the top left corner.
  */
 void lcd_clear(void) {
+#if LCD_BUFFERED
+    // Only cells that are not blank already have to be sent
+    ATOMIC {
+        charCtr = 0;
+        for (uint8_t cell = 0; cell < 32; cell++) {
+            lcd_setCell(cell, ' ');
+        }
+    }
+#else
     charCtr = 0;
     lcd_command(LCD_CLEAR);
+#endif
 }
 
 /*!
@@ -465,6 +763,7 @@ void lcd_writeString(const char *text) {
     while ((c = *text++)) {
         lcd_writeChar(c);
     }
+    lcd_flushIfAtomic();
 }
 
 /*!
@@ -501,6 +800,7 @@ void lcd_writeProgString(const char *string) {
     while ((c = (char)pgm_read_byte(string++))) {
         lcd_writeChar(c);
     }
+    lcd_flushIfAtomic();
 }
 
 /*!
@@ -524,13 +824,18 @@ void lcd_registerCustomChar(uint8_t addr, uint64_t chr) {
     const uint8_t sreg = SREG & (1 << 7);
     cli();
     lcd_command(0x40 | (0x38 & (addr << 3)));
+#if !OS_FAST_BOOT
     _delay_us(40);
+#endif
 
     uint8_t i = 8;
     while (i--) {
         const uint8_t row = chr & 0xFF;
         lcd_sendStream(((1 << LCD_RS_PIN) & 0xF0) | ((row >> 4) & 0xF), ((1 << LCD_RS_PIN) & 0xF0) | (row & 0xF));
+        // lcd_sendStream polls the busy flag before the next transfer anyway
+#if !OS_FAST_BOOT
         _delay_us(40);
+#endif
         chr >>= 8;
     }
     SREG |= sreg;
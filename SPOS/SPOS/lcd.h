@@ -116,6 +116,21 @@
 //! Timeout for the busy signal of the LCD
 #define LCD_BUSY_TIMEOUT 2000
 
+/*!
+ *  Set to 1 to queue the output and let the Timer 0 compare match B interrupt
+ *  send it, 0 sends every character synchronously with interrupts disabled.
+ *  The queue needs the running system timer, hence it requires SPOS.
+ */
+#ifndef LCD_BUFFERED
+#define LCD_BUFFERED SPOS_CONFIG
+#endif
+
+//! Number of queued nibbles, a power of two
+#define LCD_QUEUE_SIZE 64
+
+//! Timer 0 counts between two nibbles sent by the interrupt (12.8us each)
+#define LCD_DRAIN_INTERVAL 4
+
 //----------------------------------------------------------------------------
 // Macros
 //----------------------------------------------------------------------------
@@ -214,6 +229,9 @@ void lcd_command(uint8_t command);
 //! Clear all data from display
 void lcd_clear(void);
 
+//! Waits until all queued output has been sent to the LCD
+void lcd_flush(void);
+
 //! Erases one line
 void lcd_erase(uint8_t line);
 
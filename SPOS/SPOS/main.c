@@ -18,7 +18,9 @@ int main(void) {
 
     // os_init shows a boot message
     // Wait and clear the LCD
+#if !OS_FAST_BOOT
     delayMs(600);
+#endif
     lcd_clear();
 
     // Start the operating system
@@ -3,6 +3,8 @@
 #include "defines.h"
 #include "lcd.h"
 #include "os_input.h"
+#include "os_trace.h"
+#include "os_uart.h"
 #include "util.h"
 
 #include <avr/interrupt.h>
@@ -77,6 +79,7 @@ void os_checkResetSource(uint8_t allowedSources) {
     if (!(savedMCUSR & allowedSources)) {
         lcd_line1();
         lcd_writeProgString(PSTR("SYSTEM ERROR:   "));
+        lcd_flush();
         // not allowed sources must be confirmed by the user
         os_waitForInput();
         os_waitForNoInput();
@@ -94,7 +97,7 @@ void os_init_timer(void) {
     sbi(TCCR2B, CS21);   // Prescaler 1024  1
     sbi(TCCR2B, CS20);   // Prescaler 1024  1
     sbi(TIMSK2, OCIE2A); // Enable interrupt
-    OCR2A = 60;
+    OCR2A = SCHEDULER_TICK;
 
     // Init timer 0 with prescaler 256
     cbi(TCCR0B, CS00);
@@ -102,6 +105,11 @@ void os_init_timer(void) {
     sbi(TCCR0B, CS02);
 
     sbi(TIMSK0, TOIE0);
+
+#if OS_TICKS
+    // Init timer 1 as cycle counter
+    os_ticks_init();
+#endif
 }
 
 /*!
@@ -109,20 +117,38 @@ void os_init_timer(void) {
  *  it calls the sub function os_initScheduler().
  */
 void os_init(void) {
-    // Init timer 0 and 2
+    // Init timer 0, 1 and 2
     os_init_timer();
 
     // Init buttons
     os_initInput();
 
+#if OS_TRACE
+    // Init trace stream
+    os_traceInit();
+#endif
+
+#if OS_UART
+    // Init serial stdio
+    os_uartInit();
+#endif
+
     // Init LCD display
     lcd_init();
+#if OS_UART_STDOUT
+    stdout = uartout;
+#else
     stdout = lcdout;
+#endif
     stderr = lcdout;
 
     lcd_writeProgString(PSTR("Booting SPOS ..."));
     os_checkResetSource(OS_ALLOWED_RESET_SOURCES);
+    // Interrupts are still disabled, so the messages have to be sent here
+    lcd_flush();
+#if !OS_FAST_BOOT
     delayMs(DEFAULT_OUTPUT_DELAY * 20);
+#endif
 
     os_initScheduler();
 
@@ -135,5 +161,18 @@ void os_init(void) {
  *  \param str  The error to be displayed
  */
 void os_errorPStr(const char *str) {
-#error IMPLEMENT STH. HERE
+    // Save the global interrupt enable bit and turn interrupts off
+    const uint8_t sreg = SREG;
+    cli();
+
+    lcd_clear();
+    lcd_writeErrorProgString(str);
+    lcd_flush();
+
+    // The error has to be confirmed by the user
+    os_waitForInput();
+    os_waitForNoInput();
+    lcd_clear();
+
+    SREG = sreg;
 }
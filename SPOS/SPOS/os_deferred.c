@@ -0,0 +1,83 @@
+#include "os_deferred.h"
+
+#include "defines.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+/*! \file
+ *
+ * Deferred calls. An ISR that has more to do than acknowledging the
+ * hardware queues the rest with os_defer and returns. The scheduler calls
+ * os_runDeferred on its next invocation, where the calls run one after
+ * another with interrupts enabled but the scheduler held off, as in a
+ * critical section. The queue itself is only touched with interrupts
+ * disabled for a few instructions.
+ *
+ */
+
+#if (DEFERRED_QUEUE_SIZE & (DEFERRED_QUEUE_SIZE - 1)) || DEFERRED_QUEUE_SIZE > 256
+#error "DEFERRED_QUEUE_SIZE must be a power of two of at most 256"
+#endif
+
+//! Calls waiting to be run
+static DeferredCall os_deferredCalls[DEFERRED_QUEUE_SIZE];
+
+//! Index of the next call to queue
+static volatile uint8_t os_deferredHead = 0;
+
+//! Index of the next call to run
+static volatile uint8_t os_deferredTail = 0;
+
+/*!
+ *  Queues a call. The call runs on the stack of the scheduler, so it must
+ *  not block and should keep its stack usage small.
+ *
+ *  \param function The function to call.
+ *  \param arg The argument to pass to the function.
+ *  \return False if the queue was full and the call was dropped.
+ */
+bool os_defer(DeferredFunction *function, void *arg) {
+    const uint8_t sreg = SREG;
+    cli();
+    const uint8_t head = os_deferredHead;
+    const uint8_t next = (head + 1) & (DEFERRED_QUEUE_SIZE - 1);
+    const bool queued = next != os_deferredTail;
+    if (queued) {
+        os_deferredCalls[head] = (DeferredCall){.function = function, .arg = arg};
+        os_deferredHead = next;
+    }
+    SREG = sreg;
+    return queued;
+}
+
+/*!
+ *  Returns whether calls are queued. This is cheap enough for the scheduler
+ *  to check on every invocation.
+ *
+ *  \return True iff os_runDeferred has something to do.
+ */
+bool os_hasDeferred(void) {
+    return os_deferredHead != os_deferredTail;
+}
+
+/*!
+ *  Runs the queued calls in the order they were queued until the queue is
+ *  empty. The calls run with the interrupt flag as the caller left it.
+ */
+void os_runDeferred(void) {
+    while (1) {
+        const uint8_t sreg = SREG;
+        cli();
+        const uint8_t tail = os_deferredTail;
+        if (tail == os_deferredHead) {
+            SREG = sreg;
+            return;
+        }
+        const DeferredCall call = os_deferredCalls[tail];
+        os_deferredTail = (tail + 1) & (DEFERRED_QUEUE_SIZE - 1);
+        SREG = sreg;
+
+        call.function(call.arg);
+    }
+}
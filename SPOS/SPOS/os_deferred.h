@@ -0,0 +1,49 @@
+/*! \file
+ *  \brief Deferred calls for the OS.
+ *
+ *  Contains a queue of function calls that ISRs hand over to the kernel.
+ *  The scheduler runs them with interrupts enabled, so interrupt handlers
+ *  stay short and longer work does not block other interrupts.
+ *
+ *  \author   Lehrstuhl Informatik 11 - RWTH Aachen
+ *  \date     2013
+ *  \version  2.0
+ */
+
+#ifndef _OS_DEFERRED_H
+#define _OS_DEFERRED_H
+
+#include "defines.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! A function whose call can be deferred
+typedef void DeferredFunction(void *arg);
+
+//! A deferred call
+typedef struct {
+    //! The function to call
+    DeferredFunction *function;
+    //! The argument to pass
+    void *arg;
+} DeferredCall;
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Queues a call to be run by the scheduler, may be called from ISRs
+bool os_defer(DeferredFunction *function, void *arg);
+
+//! Returns whether calls are queued
+bool os_hasDeferred(void);
+
+//! Runs all queued calls, including those queued meanwhile
+void os_runDeferred(void);
+
+#endif
@@ -1,14 +1,58 @@
 #include "os_input.h"
 
+#include "os_queue.h"
+#include "os_scheduler.h"
+#include "util.h"
+
+#include <avr/interrupt.h>
 #include <avr/io.h>
 #include <stdint.h>
 
 /*! \file
 
 Everything that is necessary to get the input from the Buttons in a clean format.
+A pin change of a button starts a debounce period, which the Timer 0 overflow
+ISR counts down. Once the buttons were stable for INPUT_DEBOUNCE_TICKS
+overflows, every change is recorded as an InputEvent and the processes blocked
+in os_waitForInput or os_waitForNoInput are woken up with OS_EVENT_INPUT.
 
 */
 
+//! Processes blocked in os_waitForInput or os_waitForNoInput, bit n is set iff process n waits
+static volatile uint8_t os_inputWaiters;
+
+//! Storage of os_inputEvents
+static InputEvent os_inputEventBuffer[INPUT_EVENT_QUEUE_SIZE];
+
+//! Debounced changes of the buttons, the debounce ISR is the producer
+static Queue os_inputEvents = QUEUE_INITIALIZER(os_inputEventBuffer);
+
+//! Remaining Timer 0 overflows until the buttons are considered stable, 0 if no change is pending
+static volatile uint8_t os_debounceTicks;
+
+//! The debounced button states
+static volatile uint8_t os_stableInput;
+
+//! Set once a pin change started the debouncing, until then waiting processes poll
+static volatile bool os_debounceStarted;
+
+/*!
+ *  Starts the debounce period, bouncing restarts it. A program that takes
+ *  PCINT2_vect over has to call this from its ISR to keep the debounced input.
+ */
+void os_startDebounce(void) {
+    os_debounceTicks = INPUT_DEBOUNCE_TICKS;
+    os_debounceStarted = true;
+}
+
+/*!
+ *  Starts the debounce period whenever a button pin changes. Weak, so that
+ *  programs may take the interrupt over, see os_startDebounce.
+ */
+ISR(PCINT2_vect, __attribute__((weak))) {
+    os_startDebounce();
+}
+
 /*!
  *  A simple "Getter"-Function for the Buttons on the evaluation board.\n
  *
@@ -19,27 +63,147 @@ Everything that is necessary to get the input from the Buttons in a clean format
  *
  */
 uint8_t os_getInput(void) {
-//#error IMPLEMENT STH. HERE
-return 0;
+    // The buttons are low active and connected to C0, C1, C6 and C7
+    const uint8_t pins = ~PINC;
+    return (pins & 0x03) | ((pins & 0xC0) >> 4);
 }
 
 /*!
  *  Initializes DDR and PORT for input
  */
 void os_initInput() {
+    // Button pins are inputs with pull-ups
+    DDRC &= ~0xC3;
+    PORTC |= 0xC3;
+
+    // Changes of the button pins start the debouncing
+    os_stableInput = os_getInput();
+    PCMSK2 |= 0xC3;
+    sbi(PCICR, PCIE2);
+}
+
+/*!
+ *  Waits until the buttons are pressed (or released). A process that may
+ *  block is parked until the next debounced input change, everybody else
+ *  busy waits. Until the first pin change started the debouncing, blocking
+ *  processes only yield between two polls, as a program may have taken the
+ *  pin change interrupt over without calling os_startDebounce.
+ *
+ *  \param pressed Whether to wait for a pressed button or for all buttons to be released.
+ */
+static void os_waitForInputState(bool pressed) {
+    if (!os_canBlock()) {
+        while (!!os_getInput() != pressed) {
+            continue;
+        }
+        return;
+    }
+
+    const ProcessID self = os_getCurrentProc();
+    os_enterCriticalSection();
+    sbi(os_inputWaiters, self);
+    os_leaveCriticalSection();
 
+    // Registered before checking, so a change after the check is signaled
+    while (!!os_getInput() != pressed) {
+        if (os_debounceStarted) {
+            os_waitEvent(OS_EVENT_INPUT);
+        } else {
+            os_yield();
+        }
+    }
+
+    os_enterCriticalSection();
+    cbi(os_inputWaiters, self);
+    os_leaveCriticalSection();
 }
 
 /*!
- *  Endless loop as long as at least one button is pressed.
+ *  Waits as long as at least one button is pressed.
  */
 void os_waitForNoInput() {
-//#error IMPLEMENT STH. HERE
+    os_waitForInputState(false);
 }
 
 /*!
- *  Endless loop until at least one button is pressed.
+ *  Waits until at least one button is pressed.
  */
 void os_waitForInput() {
-//#error IMPLEMENT STH. HERE
+    os_waitForInputState(true);
+}
+
+/*!
+ *  Forgets that a process waits for input changes, so a process that later
+ *  gets its slot is not woken by them. Called by os_kill.
+ *
+ *  \param pid The killed process.
+ */
+void os_dropInputWaiter(ProcessID pid) {
+    const uint8_t sreg = SREG;
+    cli();
+    cbi(os_inputWaiters, pid);
+    SREG = sreg;
+}
+
+/*!
+ *  Returns the button states after debouncing, with the same layout as
+ *  os_getInput().
+ *
+ *  \returns The debounced state of the buttons.
+ */
+uint8_t os_getDebouncedInput(void) {
+    return os_stableInput;
+}
+
+/*!
+ *  Takes the oldest debounced press or release of a button. Events are
+ *  dropped while the queue is full. Only one process may take events.
+ *
+ *  \param event Receives the event.
+ *  \returns True iff there was an event.
+ */
+bool os_getInputEvent(InputEvent *event) {
+    return os_queue_recv(&os_inputEvents, event);
+}
+
+/*!
+ *  Takes the oldest debounced press or release of a button, blocking the
+ *  current process while there is none. Only one process may take events.
+ *
+ *  \param event Receives the event.
+ */
+void os_waitInputEvent(InputEvent *event) {
+    os_queue_recvBlocking(&os_inputEvents, event);
+}
+
+/*!
+ *  Counts the debounce period down and records the changes of the buttons
+ *  once it has passed. Runs in the Timer 0 overflow ISR, so it has to return
+ *  quickly while no change is pending.
+ */
+void os_debounceInput(void) {
+    if (!os_debounceTicks || --os_debounceTicks) {
+        return;
+    }
+
+    const uint8_t input = os_getInput();
+    const uint8_t changed = input ^ os_stableInput;
+    if (!changed) {
+        return;
+    }
+    os_stableInput = input;
+
+    const Time now = os_systemTime_coarse();
+    for (uint8_t button = 0; button < 4; button++) {
+        if (gbi(changed, button)) {
+            const InputEvent event = {.button = button, .pressed = gbi(input, button), .time = now};
+            os_queue_send(&os_inputEvents, &event);
+        }
+    }
+
+    for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+        if (gbi(os_inputWaiters, pid)) {
+            os_signalEvent(pid, OS_EVENT_INPUT);
+        }
+    }
 }
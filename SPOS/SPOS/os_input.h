@@ -11,8 +11,36 @@
 #ifndef _OS_INPUT_H
 #define _OS_INPUT_H
 
+#include "os_process.h"
+#include "util.h"
+
+#include <stdbool.h>
 #include <stdint.h>
 
+//----------------------------------------------------------------------------
+// Constants
+//----------------------------------------------------------------------------
+
+//! Timer 0 overflows the buttons have to be stable before a change is accepted (approx. 10 ms)
+#define INPUT_DEBOUNCE_TICKS 3
+
+//! Number of slots of the input event queue, it holds one event less
+#define INPUT_EVENT_QUEUE_SIZE 8
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! A debounced press or release of a button
+typedef struct {
+    //! The button, i.e. the bit of the button in the result of os_getInput()
+    uint8_t button;
+    //! Whether the button was pressed or released
+    bool pressed;
+    //! Time of the change in ms, see os_systemTime_coarse()
+    Time time;
+} InputEvent;
+
 //----------------------------------------------------------------------------
 // Function headers
 //----------------------------------------------------------------------------
@@ -29,4 +57,22 @@ void os_waitForNoInput(void);
 //! Waits for at least one button to be pressed
 void os_waitForInput(void);
 
+//! Returns the debounced button states
+uint8_t os_getDebouncedInput(void);
+
+//! Takes the oldest button event, fails if there is none
+bool os_getInputEvent(InputEvent *event);
+
+//! Takes the oldest button event, blocking the current process while there is none
+void os_waitInputEvent(InputEvent *event);
+
+//! Debounces the buttons, called by the Timer 0 overflow ISR
+void os_debounceInput(void);
+
+//! Starts the debounce period, programs that take over PCINT2_vect have to call it from their ISR
+void os_startDebounce(void);
+
+//! Stops waking a process on input changes, called when it is killed
+void os_dropInputWaiter(ProcessID pid);
+
 #endif
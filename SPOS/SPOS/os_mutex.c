@@ -0,0 +1,158 @@
+#include "os_mutex.h"
+
+#include "os_core.h"
+#include "os_scheduler.h"
+#include "util.h"
+
+/*! \file
+ *
+ * Mutexes that block contended processes. The scheduler keeps running other
+ * processes while a mutex is held, in contrast to os_enterCriticalSection.
+ * While more important processes wait, the owner inherits their priority,
+ * which os_Scheduler_RoundRobin and os_Scheduler_InactiveAging take into
+ * account. The inheritance is not transitive and the owner keeps the boost
+ * until it has released all of its mutexes. Mutexes are not released when
+ * their owner is killed. Killed waiters stay in the waiting bitmap until the
+ * next unlock, which recognizes them as they are no longer blocked on the mutex.
+ *
+ */
+
+extern uint8_t criticalSectionCount;
+
+/*!
+ *  The process table of the scheduler. Unlike os_getProcessSlot, accessing it
+ *  directly keeps the process bitmaps valid, which is fine as long as the
+ *  state and the priorities are only changed through the scheduler's setters.
+ */
+extern Process os_processes[MAX_NUMBER_OF_PROCESSES];
+
+/*!
+ *  Raises the inherited priority of the owner of a mutex to the given priority.
+ *
+ *  \param owner The process that holds the mutex.
+ *  \param priority The effective priority of a process waiting for the mutex.
+ */
+static void os_mutexInherit(ProcessID owner, Priority priority) {
+    if (priority > os_getEffectivePriority(&os_processes[owner])) {
+        os_setInheritedPriority(owner, priority);
+    }
+}
+
+/*!
+ *  Initializes a mutex such that it is free and nobody waits for it.
+ *
+ *  \param mutex The mutex to initialize.
+ */
+void os_mutexInit(Mutex *mutex) {
+    *mutex = (Mutex)MUTEX_INITIALIZER;
+}
+
+/*!
+ *  Acquires a mutex. While another process holds it, the current process is
+ *  blocked and the owner inherits its priority. The mutex is handed over
+ *  directly on unlock, so a woken process always owns the mutex.
+ *  The idle process and processes inside critical sections cannot block,
+ *  so os_error is raised if they would have to wait.
+ *
+ *  \param mutex The mutex to acquire.
+ */
+void os_mutexLock(Mutex *mutex) {
+    os_enterCriticalSection();
+    const ProcessID self = os_getCurrentProc();
+
+    if (mutex->owner == self) {
+        os_error("Mutex locked twice");
+    } else if (mutex->owner == INVALID_PROCESS) {
+        mutex->owner = self;
+        os_processes[self].heldMutexes++;
+    } else if (self == 0 || criticalSectionCount > 1) {
+        os_error("Mutex would block");
+    } else {
+        sbi(mutex->waiting, self);
+        os_processes[self].blockedOn = mutex;
+        os_mutexInherit(mutex->owner, os_getEffectivePriority(&os_processes[self]));
+        do {
+            os_setProcessState(self, OS_PS_BLOCKED);
+            os_leaveCriticalSection();
+            // If the scheduler preempted us right after leaving the critical section, this merely yields once more
+            os_yield();
+            os_enterCriticalSection();
+        } while (mutex->owner != self);
+        os_processes[self].blockedOn = NULL;
+    }
+
+    os_leaveCriticalSection();
+}
+
+/*!
+ *  Acquires a mutex if that is possible without blocking.
+ *
+ *  \param mutex The mutex to acquire.
+ *  \return True iff the current process acquired the mutex.
+ */
+bool os_mutexTryLock(Mutex *mutex) {
+    os_enterCriticalSection();
+    const ProcessID self = os_getCurrentProc();
+
+    const bool acquired = mutex->owner == INVALID_PROCESS;
+    if (acquired) {
+        mutex->owner = self;
+        os_processes[self].heldMutexes++;
+    }
+
+    os_leaveCriticalSection();
+    return acquired;
+}
+
+/*!
+ *  Releases a mutex held by the current process. If processes wait for it,
+ *  the one with the highest effective priority (the lowest id on ties)
+ *  becomes the new owner and is made ready.
+ *
+ *  \param mutex The mutex to release.
+ */
+void os_mutexUnlock(Mutex *mutex) {
+    os_enterCriticalSection();
+    const ProcessID self = os_getCurrentProc();
+
+    if (mutex->owner != self) {
+        os_error("Mutex not held");
+        os_leaveCriticalSection();
+        return;
+    }
+
+    if (!--os_processes[self].heldMutexes) {
+        os_setInheritedPriority(self, 0);
+    }
+
+    // Pick the most important waiter. Waiters that were killed in the meantime are dropped, even if their slot
+    // was reused by a process that is blocked on something else.
+    ProcessID next = INVALID_PROCESS;
+    for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+        const Process *const process = &os_processes[pid];
+        if (!gbi(mutex->waiting, pid)) {
+            continue;
+        }
+        if (process->state != OS_PS_BLOCKED || process->blockedOn != mutex) {
+            cbi(mutex->waiting, pid);
+        } else if (next == INVALID_PROCESS || os_getEffectivePriority(process) > os_getEffectivePriority(&os_processes[next])) {
+            next = pid;
+        }
+    }
+
+    mutex->owner = next;
+    if (next != INVALID_PROCESS) {
+        cbi(mutex->waiting, next);
+        os_processes[next].heldMutexes++;
+
+        // The remaining waiters now wait for the new owner
+        for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+            if (gbi(mutex->waiting, pid)) {
+                os_mutexInherit(next, os_getEffectivePriority(&os_processes[pid]));
+            }
+        }
+        os_setProcessState(next, OS_PS_READY);
+    }
+
+    os_leaveCriticalSection();
+}
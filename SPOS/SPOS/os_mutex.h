@@ -0,0 +1,53 @@
+/*! \file
+ *  \brief Blocking mutexes for the OS.
+ *
+ *  Contains mutexes that park contended processes instead of stopping the
+ *  scheduler, with priority inheritance for the priority based strategies.
+ *
+ *  \author   Lehrstuhl Informatik 11 - RWTH Aachen
+ *  \date     2013
+ *  \version  2.0
+ */
+
+#ifndef _OS_MUTEX_H
+#define _OS_MUTEX_H
+
+#include "defines.h"
+#include "os_process.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! A mutex, which has to be initialized with MUTEX_INITIALIZER or os_mutexInit
+typedef struct {
+    //! The process holding the mutex or INVALID_PROCESS if it is free
+    ProcessID owner;
+    //! Processes blocked on the mutex, bit n is set iff process n waits
+    uint8_t waiting;
+} Mutex;
+
+//! Static initializer of a free mutex
+#define MUTEX_INITIALIZER \
+    { .owner = INVALID_PROCESS, .waiting = 0 }
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Initializes a free mutex
+void os_mutexInit(Mutex *mutex);
+
+//! Acquires a mutex, blocking the current process while it is held by another one
+void os_mutexLock(Mutex *mutex);
+
+//! Acquires a mutex if it is free
+bool os_mutexTryLock(Mutex *mutex);
+
+//! Releases a mutex and hands it to the most important waiting process
+void os_mutexUnlock(Mutex *mutex);
+
+#endif
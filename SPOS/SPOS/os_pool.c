@@ -0,0 +1,142 @@
+#include "os_pool.h"
+
+#include "defines.h"
+#include "os_core.h"
+#include "util.h"
+
+#include <avr/interrupt.h>
+
+/*! \file
+ *
+ * Fixed-size block pools. The free blocks of a pool form a singly linked
+ * list that is stored in the blocks themselves, so a pool needs no map and
+ * allocating or freeing a block only moves the head of that list.
+ * As pools may be used from ISRs, the list is protected by disabling
+ * interrupts for a few instructions.
+ *
+ */
+
+//! Head of the list of all initialized pools
+static Pool *os_pools = NULL;
+
+/*!
+ *  Carves a region into as many blocks of the given size as fit and links
+ *  all of them into the free list. The pool is then registered, so the task
+ *  manager can show its occupancy. A pool must not be initialized twice.
+ *
+ *  \param pool The pool to initialize.
+ *  \param name The name of the pool in program memory (at most 10 characters), e.g. PSTR("Messages").
+ *  \param region The memory the blocks are carved from.
+ *  \param regionSize The size of the region in bytes, see POOL_REGION_SIZE.
+ *  \param blockSize The size of every block in bytes, raised to the size of a pointer if smaller.
+ */
+void os_poolInit(Pool *pool, const char *name, void *region, uint16_t regionSize, uint16_t blockSize) {
+    if (blockSize < sizeof(PoolBlock)) {
+        blockSize = sizeof(PoolBlock);
+    }
+
+    pool->name = name;
+    pool->start = region;
+    pool->blockSize = blockSize;
+    pool->blockCount = regionSize / blockSize;
+    pool->used = 0;
+    pool->peak = 0;
+
+    // Link the blocks in ascending order, so they are handed out from the start of the region
+    PoolBlock *next = NULL;
+    for (uint16_t i = pool->blockCount; i--;) {
+        PoolBlock *const block = (PoolBlock *)(pool->start + i * blockSize);
+        block->next = next;
+        next = block;
+    }
+    pool->free = next;
+
+    const uint8_t sreg = SREG;
+    cli();
+    pool->next = os_pools;
+    os_pools = pool;
+    SREG = sreg;
+}
+
+/*!
+ *  Takes the first block of the free list.
+ *
+ *  \param pool The pool to allocate from.
+ *  \return The block, or NULL if all blocks are allocated.
+ */
+void *os_poolAlloc(Pool *pool) {
+    const uint8_t sreg = SREG;
+    cli();
+    PoolBlock *const block = pool->free;
+    if (block) {
+        pool->free = block->next;
+        if (++pool->used > pool->peak) {
+            pool->peak = pool->used;
+        }
+    }
+    SREG = sreg;
+    return block;
+}
+
+/*!
+ *  Puts a block back at the front of the free list. Pointers that do not
+ *  point to the start of a block of this pool are rejected. If OS_POOL_CHECK
+ *  is set, blocks that are already free are rejected as well, which walks the
+ *  free list with interrupts disabled.
+ *
+ *  \param pool The pool the block was allocated from.
+ *  \param block The block to free, NULL is ignored.
+ */
+void os_poolFree(Pool *pool, void *block) {
+    if (!block) {
+        return;
+    }
+    const uint16_t offset = (uint8_t *)block - pool->start;
+    if ((uint8_t *)block < pool->start || offset >= pool->blockCount * pool->blockSize || offset % pool->blockSize) {
+        os_error("Block not in pool");
+        return;
+    }
+
+    const uint8_t sreg = SREG;
+    cli();
+#if OS_POOL_CHECK
+    for (const PoolBlock *free = pool->free; free; free = free->next) {
+        if (free == block) {
+            SREG = sreg;
+            os_error("Block freed twice");
+            return;
+        }
+    }
+#endif
+    ((PoolBlock *)block)->next = pool->free;
+    pool->free = block;
+    pool->used--;
+    SREG = sreg;
+}
+
+/*!
+ *  Returns the number of pools that were initialized so far.
+ *
+ *  \return The number of registered pools.
+ */
+uint8_t os_getPoolListLength(void) {
+    uint8_t length = 0;
+    for (const Pool *pool = os_pools; pool; pool = pool->next) {
+        length++;
+    }
+    return length;
+}
+
+/*!
+ *  Returns a registered pool. The most recently initialized pool has index 0.
+ *
+ *  \param index The index of the pool.
+ *  \return The pool, or NULL if there are not that many pools.
+ */
+Pool *os_lookupPool(uint8_t index) {
+    Pool *pool = os_pools;
+    while (pool && index--) {
+        pool = pool->next;
+    }
+    return pool;
+}
@@ -0,0 +1,70 @@
+/*! \file
+ *  \brief Fixed-size block pools for the OS.
+ *
+ *  Contains pools that carve a memory region into blocks of one size.
+ *  Allocating and freeing a block takes constant time and does not
+ *  fragment the region.
+ *
+ *  \author   Lehrstuhl Informatik 11 - RWTH Aachen
+ *  \date     2013
+ *  \version  2.0
+ */
+
+#ifndef _OS_POOL_H
+#define _OS_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! A free block, its first bytes link to the next free block
+typedef struct PoolBlock {
+    struct PoolBlock *next;
+} PoolBlock;
+
+//! A pool of equally sized blocks, which has to be initialized with os_poolInit
+typedef struct Pool {
+    //! Name of the pool in program memory, shown by the task manager
+    const char *name;
+    //! First byte of the region
+    uint8_t *start;
+    //! Size of every block in bytes
+    uint16_t blockSize;
+    //! Number of blocks in the region
+    uint16_t blockCount;
+    //! Number of allocated blocks
+    uint16_t used;
+    //! Highest number of blocks that were allocated at the same time
+    uint16_t peak;
+    //! First free block, NULL if the pool is exhausted
+    PoolBlock *free;
+    //! Next pool in the list of all pools, see os_lookupPool
+    struct Pool *next;
+} Pool;
+
+//! Size of a region that holds COUNT blocks of SIZE bytes
+#define POOL_REGION_SIZE(SIZE, COUNT) ((((SIZE) < sizeof(PoolBlock)) ? sizeof(PoolBlock) : (SIZE)) * (COUNT))
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Carves a region into blocks of the given size and registers the pool
+void os_poolInit(Pool *pool, const char *name, void *region, uint16_t regionSize, uint16_t blockSize);
+
+//! Allocates a block, returns NULL if the pool is exhausted
+void *os_poolAlloc(Pool *pool);
+
+//! Returns a block to its pool
+void os_poolFree(Pool *pool, void *block);
+
+//! Returns the number of registered pools
+uint8_t os_getPoolListLength(void);
+
+//! Returns the registered pool with the given index, NULL if there is none
+Pool *os_lookupPool(uint8_t index);
+
+#endif
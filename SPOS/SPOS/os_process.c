@@ -17,3 +17,15 @@ bool os_isRunnable(const Process *process) {
 
     return false;
 }
+
+/*!
+ *  The priority the strategies have to use for a process. It is raised above
+ *  the priority of the process while a more important process waits for a
+ *  mutex the process holds.
+ *
+ *  \param process A pointer on the process
+ *  \return The maximum of the priority and the inherited priority of the process
+ */
+Priority os_getEffectivePriority(const Process *process) {
+    return process->inheritedPriority > process->priority ? process->inheritedPriority : process->priority;
+}
@@ -11,10 +11,16 @@
 #ifndef _OS_PROCESS_H
 #define _OS_PROCESS_H
 
+#include "defines.h"
+
 #include <stdbool.h>
 #include <stdint.h>
 
+//! The type of a process' id.
+typedef uint8_t ProcessID;
 
+//! The type of a program.
+typedef void Program(void);
 
 //! The type of the priority of a process.
 typedef uint8_t Priority;
@@ -25,6 +31,9 @@ typedef uint16_t Age;
 //! The type for the checksum used to check stack consistency.
 typedef uint8_t StackChecksum;
 
+//! The type of the size of a process' stack in bytes.
+typedef uint16_t StackSize;
+
 //! Type for the state a specific process is currently in.
 typedef enum ProcessState {
     OS_PS_UNUSED,
@@ -47,7 +56,36 @@ typedef union StackPointer {
  */
 
 typedef struct {
-    
+    //! The state the process is currently in
+    ProcessState state;
+    //! The stack pointer of the process. While the process is suspended, it points right below its saved context
+    StackPointer sp;
+    //! The priority of the process
+    Priority priority;
+    //! The program the process executes
+    Program *program;
+    //! The checksum over the used stack region, taken when the process was suspended
+    StackChecksum checksum;
+    //! The highest address of the stack of the process
+    uint16_t stackBottom;
+    //! The number of bytes reserved for the stack of the process
+    StackSize stackSize;
+    //! Accumulated run time of the process in os_systemTime_augment() ticks, without the scheduler
+    uint32_t runTime;
+    //! Number of times the scheduler switched to the process
+    uint16_t scheduleCount;
+    //! Number of times the process was suspended although it could have continued
+    uint16_t preemptCount;
+    //! Number of times the process gave up the processor by calling os_yield
+    uint16_t yieldCount;
+    //! Deepest stack usage in bytes seen when the process was suspended
+    StackSize stackPeak;
+    //! Highest priority of the processes waiting for a mutex of this process, 0 if there is none
+    Priority inheritedPriority;
+    //! Number of mutexes the process currently holds
+    uint8_t heldMutexes;
+    //! The mutex, semaphore or queue the process is blocked on, NULL if there is none
+    const void *blockedOn;
 } Process;
 
 /*!
@@ -57,6 +95,7 @@ typedef struct {
  */
 struct program_linked_list_node {
     void *program;
+    StackSize stackSize;
     struct program_linked_list_node *next;
 };
 
@@ -66,6 +105,23 @@ struct program_linked_list_node {
  */
 extern struct program_linked_list_node *autostart_head;
 
+/*!
+ *  Descriptor of a program registered with REGISTER_AUTOSTART_FLASH.
+ *  The descriptors reside in program memory and have to be read with pgm_read_*.
+ */
+typedef struct {
+    Program *program;
+    Priority priority;
+    StackSize stackSize;
+} AutostartEntry;
+
+/*!
+ *  Bounds of the table of REGISTER_AUTOSTART_FLASH descriptors, defined by the
+ *  linker script autostart.ld. Without that script both are NULL, so the table is empty.
+ */
+extern const AutostartEntry __autostart_start[] __attribute__((weak));
+extern const AutostartEntry __autostart_end[] __attribute__((weak));
+
 /*!
  *  Prepends the passed program function to the autostart linked list.
  *
@@ -81,16 +137,49 @@ extern struct program_linked_list_node *autostart_head;
  *      bar();
  *      ...
  *    }
+ *
+ *  The process gets a stack of STACK_SIZE_PROC bytes, use
+ *  REGISTER_AUTOSTART_WITH_STACK to request a different size.
  */
-#define REGISTER_AUTOSTART(PROGRAM_FUNCTION)                                         \
-    Program PROGRAM_FUNCTION;                                                        \
-    void __attribute__((constructor)) register_autostart_##PROGRAM_FUNCTION(void) {  \
-        static struct program_linked_list_node node = {.program = PROGRAM_FUNCTION}; \
-        node.next = autostart_head;                                                  \
-        autostart_head = &node;                                                      \
+#define REGISTER_AUTOSTART(PROGRAM_FUNCTION) REGISTER_AUTOSTART_WITH_STACK(PROGRAM_FUNCTION, STACK_SIZE_PROC)
+
+//! Like REGISTER_AUTOSTART, but the process gets a stack of STACK_SIZE bytes.
+#if OS_AUTOSTART_FLASH
+#define REGISTER_AUTOSTART_WITH_STACK(PROGRAM_FUNCTION, STACK_SIZE) \
+    REGISTER_AUTOSTART_FLASH(PROGRAM_FUNCTION, DEFAULT_PRIORITY, STACK_SIZE)
+#else
+#define REGISTER_AUTOSTART_WITH_STACK(PROGRAM_FUNCTION, STACK_SIZE)                                              \
+    Program PROGRAM_FUNCTION;                                                                                    \
+    void __attribute__((constructor)) register_autostart_##PROGRAM_FUNCTION(void) {                              \
+        static struct program_linked_list_node node = {.program = PROGRAM_FUNCTION, .stackSize = (STACK_SIZE)}; \
+        node.next = autostart_head;                                                                              \
+        autostart_head = &node;                                                                                  \
     }
+#endif
+
+/*!
+ *  Registers a program to be started at boot with the given priority and
+ *  stack size. Unlike REGISTER_AUTOSTART, this neither takes RAM nor runs
+ *  code at startup: the descriptor is placed in the section .autostart,
+ *  which the linker script autostart.ld collects in program memory.
+ *  os_initScheduler starts these programs after the ones registered with
+ *  REGISTER_AUTOSTART, in link order.
+ *
+ *    REGISTER_AUTOSTART_FLASH(foobar, 5, STACK_SIZE_PROC);
+ *    void foobar(void) {
+ *      ...
+ *    }
+ */
+#define REGISTER_AUTOSTART_FLASH(PROGRAM_FUNCTION, PRIORITY, STACK_SIZE)                        \
+    Program PROGRAM_FUNCTION;                                                                  \
+    static const AutostartEntry autostart_entry_##PROGRAM_FUNCTION                             \
+        __attribute__((used, section(".autostart"))) = {                                       \
+            .program = PROGRAM_FUNCTION, .priority = (PRIORITY), .stackSize = (STACK_SIZE)};
 
 //! Returns whether the passed process can be selected to run.
 bool os_isRunnable(const Process *process);
 
+//! Returns the priority of the passed process including inherited priorities.
+Priority os_getEffectivePriority(const Process *process);
+
 #endif
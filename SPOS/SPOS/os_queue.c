@@ -0,0 +1,163 @@
+#include "os_queue.h"
+
+#include "os_core.h"
+#include "os_scheduler.h"
+#include "util.h"
+
+#include <avr/interrupt.h>
+#include <string.h>
+
+/*! \file
+ *
+ * Single-producer/single-consumer message queues. The producer is the only
+ * one writing head and the consumer the only one writing tail. Both indices
+ * are single bytes, so they are read and written atomically and the
+ * non-blocking operations work without critical sections. A message is
+ * copied before the index that publishes it is moved. Only blocking the
+ * consumer and waking it up disable interrupts for a few instructions, as
+ * the producer may be an ISR.
+ *
+ */
+
+extern uint8_t criticalSectionCount;
+
+//! The process table of the scheduler, accessed directly as os_getProcessSlot would mark the process bitmaps stale
+extern Process os_processes[MAX_NUMBER_OF_PROCESSES];
+
+//! Keeps the compiler from moving the copy of a message across the update of an index
+#define MEMORY_BARRIER() __asm__ volatile("" ::: "memory")
+
+/*!
+ *  Advances a ring buffer index by one slot.
+ *
+ *  \param queue The queue the index belongs to.
+ *  \param index The index to advance.
+ *  \return The index of the following slot.
+ */
+static uint8_t os_queue_next(const Queue *queue, uint8_t index) {
+    return ++index == queue->capacity ? 0 : index;
+}
+
+/*!
+ *  Initializes an empty queue without a blocked consumer.
+ *
+ *  \param queue The queue to initialize.
+ *  \param data Storage for capacity messages of itemSize bytes each.
+ *  \param itemSize The size of a message in bytes.
+ *  \param capacity The number of message slots in data, the queue holds up to capacity - 1 messages.
+ */
+void os_queue_init(Queue *queue, void *data, uint8_t itemSize, uint8_t capacity) {
+    queue->data = data;
+    queue->itemSize = itemSize;
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->tail = 0;
+    queue->reader = INVALID_PROCESS;
+}
+
+/*!
+ *  Appends a message to the queue and wakes up the consumer if it is blocked
+ *  on the empty queue. Must only be called by the producer, which may also be
+ *  an ISR.
+ *
+ *  \param queue The queue to append to.
+ *  \param item The message, itemSize bytes are copied.
+ *  \return True iff the message was appended, false if the queue is full.
+ */
+bool os_queue_send(Queue *queue, const void *item) {
+    const uint8_t head = queue->head;
+    const uint8_t next = os_queue_next(queue, head);
+    if (next == queue->tail) {
+        return false;
+    }
+
+    memcpy(queue->data + head * queue->itemSize, item, queue->itemSize);
+    MEMORY_BARRIER();
+    queue->head = next;
+
+    // The consumer checks for new messages and registers itself with interrupts disabled,
+    // so it has either seen this message or is registered by now
+    if (queue->reader != INVALID_PROCESS) {
+        const uint8_t sreg = SREG;
+        cli();
+        const ProcessID reader = queue->reader;
+        if (reader != INVALID_PROCESS) {
+            queue->reader = INVALID_PROCESS;
+            // A killed reader may have left its id behind for a process that reused its slot
+            if (os_processes[reader].state == OS_PS_BLOCKED && os_processes[reader].blockedOn == queue) {
+                os_setProcessState(reader, OS_PS_READY);
+            }
+        }
+        SREG = sreg;
+    }
+    return true;
+}
+
+/*!
+ *  Takes the oldest message from the queue. Must only be called by the consumer.
+ *
+ *  \param queue The queue to take the message from.
+ *  \param item Receives the message, itemSize bytes are copied.
+ *  \return True iff a message was taken, false if the queue is empty.
+ */
+bool os_queue_recv(Queue *queue, void *item) {
+    const uint8_t tail = queue->tail;
+    if (tail == queue->head) {
+        return false;
+    }
+
+    memcpy(item, queue->data + tail * queue->itemSize, queue->itemSize);
+    MEMORY_BARRIER();
+    queue->tail = os_queue_next(queue, tail);
+    return true;
+}
+
+/*!
+ *  Takes the oldest message from the queue. While the queue is empty, the
+ *  current process is blocked until the producer sends the next message.
+ *  Must only be called by the consumer. The idle process and processes
+ *  inside critical sections cannot block, so os_error is raised if they
+ *  would have to wait.
+ *
+ *  \param queue The queue to take the message from.
+ *  \param item Receives the message, itemSize bytes are copied.
+ */
+void os_queue_recvBlocking(Queue *queue, void *item) {
+    while (!os_queue_recv(queue, item)) {
+        const ProcessID self = os_getCurrentProc();
+        if (self == 0 || criticalSectionCount) {
+            os_error("Queue would block");
+            return;
+        }
+
+        // The producer may have sent a message since the check above. It may be an ISR,
+        // so a critical section, which only holds off the scheduler, is not enough here.
+        const uint8_t sreg = SREG;
+        cli();
+        const bool empty = queue->tail == queue->head;
+        if (empty) {
+            queue->reader = self;
+            os_processes[self].blockedOn = queue;
+            os_setProcessState(self, OS_PS_BLOCKED);
+        }
+        SREG = sreg;
+        if (empty) {
+            // If the scheduler preempted us right after restoring the SREG, this merely yields once more
+            os_yield();
+        }
+    }
+    os_processes[os_getCurrentProc()].blockedOn = NULL;
+}
+
+/*!
+ *  Returns the number of messages in the queue. As the producer and the
+ *  consumer keep running, this is only a snapshot.
+ *
+ *  \param queue The queue to inspect.
+ *  \return The number of messages that can be received right now.
+ */
+uint8_t os_queue_count(const Queue *queue) {
+    const uint8_t head = queue->head;
+    const uint8_t tail = queue->tail;
+    return head >= tail ? head - tail : queue->capacity - tail + head;
+}
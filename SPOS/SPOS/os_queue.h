@@ -0,0 +1,77 @@
+/*! \file
+ *  \brief Message queues for the OS.
+ *
+ *  Contains fixed-capacity single-producer/single-consumer ring buffers that
+ *  transport messages between processes (or from an ISR to a process)
+ *  without critical sections.
+ *
+ *  \author   Lehrstuhl Informatik 11 - RWTH Aachen
+ *  \date     2013
+ *  \version  2.0
+ */
+
+#ifndef _OS_QUEUE_H
+#define _OS_QUEUE_H
+
+#include "defines.h"
+#include "os_process.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+/*!
+ *  A ring buffer of equally sized messages. Exactly one producer may call
+ *  os_queue_send and exactly one consumer os_queue_recv or
+ *  os_queue_recvBlocking. One slot always stays free, so a buffer of n
+ *  messages holds up to n - 1 of them.
+ */
+typedef struct {
+    //! Storage of capacity messages of itemSize bytes each
+    uint8_t *data;
+    //! Size of a message in bytes
+    uint8_t itemSize;
+    //! Number of message slots in data
+    uint8_t capacity;
+    //! Slot the next message is written to, only written by the producer
+    volatile uint8_t head;
+    //! Slot the next message is read from, only written by the consumer
+    volatile uint8_t tail;
+    //! The consumer if it is blocked on the empty queue, INVALID_PROCESS otherwise
+    volatile ProcessID reader;
+} Queue;
+
+//! Static initializer of an empty queue that works on the array BUFFER, whose element type is the message type
+#define QUEUE_INITIALIZER(BUFFER)                            \
+    {                                                        \
+        .data = (uint8_t *)(BUFFER),                         \
+        .itemSize = sizeof((BUFFER)[0]),                     \
+        .capacity = sizeof(BUFFER) / sizeof((BUFFER)[0]),    \
+        .head = 0,                                           \
+        .tail = 0,                                           \
+        .reader = INVALID_PROCESS                            \
+    }
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Initializes an empty queue on the given storage
+void os_queue_init(Queue *queue, void *data, uint8_t itemSize, uint8_t capacity);
+
+//! Appends a message to the queue, fails if it is full
+bool os_queue_send(Queue *queue, const void *item);
+
+//! Takes the oldest message from the queue, fails if it is empty
+bool os_queue_recv(Queue *queue, void *item);
+
+//! Takes the oldest message from the queue, blocking the current process while it is empty
+void os_queue_recvBlocking(Queue *queue, void *item);
+
+//! Returns the number of messages in the queue
+uint8_t os_queue_count(const Queue *queue);
+
+#endif
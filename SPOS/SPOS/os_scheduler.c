@@ -0,0 +1,1198 @@
+#include "os_scheduler.h"
+
+#include "lcd.h"
+#include "os_core.h"
+#include "os_deferred.h"
+#include "os_input.h"
+#include "os_scheduling_strategies.h"
+#include "os_taskman.h"
+#include "os_trace.h"
+#include "util.h"
+
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <string.h>
+
+/*! \file
+ *
+ * The scheduler of the OS. It owns the process table, starts programs and
+ * switches between processes on every Timer 2 compare match.
+ *
+ */
+
+#if MAX_NUMBER_OF_PROCESSES > 8
+#error "The process bitmaps only hold 8 processes."
+#endif
+
+//----------------------------------------------------------------------------
+// Globals
+//----------------------------------------------------------------------------
+
+//! Array of states for every possible process
+Process os_processes[MAX_NUMBER_OF_PROCESSES];
+
+//! Index of process that is currently executed (default: idle)
+ProcessID currentProc;
+
+//! Currently active scheduling strategy
+#ifdef OS_FIXED_STRATEGY
+//! The strategy is fixed at compile time, so the dispatch folds into a single call
+#define currentStrategy ((SchedulingStrategy)(OS_FIXED_STRATEGY))
+#else
+static SchedulingStrategy currentStrategy = OS_SS_EVEN;
+#endif
+
+//! Nesting depth of critical sections
+uint8_t criticalSectionCount;
+
+//! Counters of the scheduler, see os_getSchedulerStats
+static SchedulerStats os_schedulerStats;
+
+//! System time at which the current invocation of the scheduler started
+static Time os_schedulerStart;
+
+//! System time at which the current process was resumed
+static Time os_runStart;
+
+//! System time at which the outermost critical section was entered
+static Time os_criticalStart;
+
+#if OS_CRITICAL_STATS
+//! Code address that entered the outermost critical section
+static uint16_t os_criticalPc;
+#endif
+
+//! Whether the current invocation of the scheduler came from os_yield
+static bool os_voluntarySwitch;
+
+//! Whether deferred calls are running on the scheduler's stack, see os_runDeferredCalls
+static bool os_inDeferredCalls;
+
+//! Set when a deferred call killed the current process, whose context must then not be saved
+static bool os_currentProcKilled;
+
+//! Whether the current tick was stretched beyond SCHEDULER_TICK as only the idle process was ready
+static bool os_tickStretched;
+
+/*!
+ *  Bitmaps of os_processes. os_exec, os_kill and os_setProcessState keep them
+ *  up to date, so the strategies never have to scan the process table.
+ */
+static ProcessMask os_processMask;
+
+//! Processes blocked in os_sleep, bit n is set iff process n sleeps
+static uint8_t os_sleepingMask;
+
+//! Raw system time at which each sleeping process becomes ready again
+static Time os_wakeTime[MAX_NUMBER_OF_PROCESSES];
+
+//! Processes that called os_waitPeriod, bit n is set iff process n is periodic
+static uint8_t os_periodicMask;
+
+//! Raw system time of the next release of each periodic process
+static Time os_nextRelease[MAX_NUMBER_OF_PROCESSES];
+
+//! Event flags signaled to each process and not yet taken by os_waitEvent
+static volatile EventMask os_eventFlags[MAX_NUMBER_OF_PROCESSES];
+
+//! Events each process blocked in os_waitEvent waits for, 0 if it does not wait
+static EventMask os_eventWaitMask[MAX_NUMBER_OF_PROCESSES];
+
+#if OS_STACK_CHECK == OS_STACK_CHECK_WINDOW
+//! Checksums over the whole stacks of suspended processes, taken by the idle process
+static StackChecksum os_fullChecksum[MAX_NUMBER_OF_PROCESSES];
+
+//! Bit n is set iff os_fullChecksum[n] was taken during the current suspension of process n
+static uint8_t os_fullChecksumValid;
+#endif
+
+/*!
+ *  Set whenever a slot is handed out through os_getProcessSlot, as the caller may
+ *  modify it behind our back at any later time. Until the next setter clears
+ *  it, the bitmaps are rebuilt on every lookup, see os_syncProcessMask.
+ */
+static volatile bool os_processMaskStale;
+
+//----------------------------------------------------------------------------
+// Private and forward declarations
+//----------------------------------------------------------------------------
+
+//! ISR for timer compare match (scheduler)
+ISR(TIMER2_COMPA_vect) __attribute__((naked));
+
+//! Cooperative context switch, naked since it builds the frame itself
+void os_yield(void) __attribute__((naked));
+
+//! Result of os_scheduleNext: the interrupted process continues
+#define SCHEDULE_CONTINUE 0
+//! Result of os_scheduleNext: the context of the interrupted process is completed and another one is resumed
+#define SCHEDULE_SWITCH 1
+//! Result of os_scheduleNext: the interrupted process was killed, so nothing more is pushed onto its stack
+#define SCHEDULE_DISCARD 2
+
+//! First half of the scheduler, called from assembly
+uint8_t os_scheduleNext(bool voluntary) __attribute__((used));
+
+//! Second half of the scheduler, called from assembly
+uint16_t os_dispatch(uint16_t sp) __attribute__((used));
+
+//! The idle program
+void idle(void);
+
+//! Makes sleeping processes ready again once their time has come
+static Time os_wakeSleepers(void);
+
+//! XOR over the stack of a process from its stack pointer up to the given address
+static StackChecksum os_checksumStackUpTo(ProcessID pid, const uint8_t *bottom);
+
+//! Process chosen by os_scheduleNext that os_dispatch switches to
+static ProcessID nextProc;
+
+/*!
+ *  Timer interrupt that implements our scheduler. Execution of the running
+ *  process is suspended and the call-clobbered registers are saved to its stack.
+ *  Then the periphery is scanned for any input events and the next process is
+ *  derived with an exchangeable strategy. As the C code doing so preserves all
+ *  other registers, the interrupted process is resumed right away if it was
+ *  chosen again. Only when switching processes the rest of the context is saved,
+ *  and the scheduler restores the next process for execution and releases
+ *  control over the processor to that process.
+ */
+ISR(TIMER2_COMPA_vect) {
+    saveCallerContext();
+
+    // Decide on the scheduler's stack, remembering the stack pointer of the process on it
+    __asm__ volatile(
+        "in   r26, __SP_L__                  \n\t"
+        "in   r27, __SP_H__                  \n\t"
+        "ldi  r24, lo8(%[isrStack])          \n\t"
+        "ldi  r25, hi8(%[isrStack])          \n\t"
+        "out  __SP_H__, r25                  \n\t"
+        "out  __SP_L__, r24                  \n\t"
+        "push r26                            \n\t"
+        "push r27                            \n\t"
+        "ldi  r24, 0                         \n\t" // not voluntary
+        "call os_scheduleNext                \n\t"
+        "pop  r27                            \n\t"
+        "pop  r26                            \n\t"
+        "out  __SP_H__, r27                  \n\t"
+        "out  __SP_L__, r26                  \n\t"
+        "cpi  r24, %[keep]               \n\t"
+        "brne 1f                             \n\t"
+        :
+        : [isrStack] "i"(BOTTOM_OF_ISR_STACK), [keep] "i"(SCHEDULE_CONTINUE));
+
+    // Fast path: the interrupted process continues
+    restoreCallerContext();
+
+    // Slow path: complete the frame and switch to the next process. The stack of a killed
+    // process may already belong to a new one, so its frame is neither completed nor saved.
+    __asm__ volatile(
+        "1:                                  \n\t"
+        "cpi  r24, %[discard]                \n\t"
+        "breq 2f                             \n\t"
+        :
+        : [discard] "i"(SCHEDULE_DISCARD));
+    saveCalleeContext();
+    __asm__ volatile(
+        "in   r24, __SP_L__                  \n\t"
+        "in   r25, __SP_H__                  \n\t"
+        "2:                                  \n\t"
+        "ldi  r26, lo8(%[isrStack])          \n\t"
+        "ldi  r27, hi8(%[isrStack])          \n\t"
+        "out  __SP_H__, r27                  \n\t"
+        "out  __SP_L__, r26                  \n\t"
+        "call os_dispatch                    \n\t"
+        "out  __SP_H__, r25                  \n\t"
+        "out  __SP_L__, r24                  \n\t"
+        :
+        : [isrStack] "i"(BOTTOM_OF_ISR_STACK));
+    restoreContext();
+}
+
+/*!
+ *  Gives up the processor voluntarily. Since this is a function call, the
+ *  caller already treats the call-clobbered registers as destroyed. Their
+ *  slots in the frame are therefore only reserved, and just SREG, the zero
+ *  register and the callee-saved registers are actually stored. The frame has
+ *  the same layout as the one built by the scheduler interrupt, so the process
+ *  is resumed by the regular restoreContext().
+ */
+void os_yield(void) {
+    __asm__ volatile(
+        "in   r18, __SREG__                  \n\t"
+        "cli                                 \n\t"
+        "in   r30, __SP_L__                  \n\t"
+        "in   r31, __SP_H__                  \n\t"
+        "sbiw r30, 15                        \n\t"
+        "out  __SP_H__, r31                  \n\t"
+        "out  __SP_L__, r30                  \n\t"
+        "std  Z+14, r18                      \n\t" // slot of SREG
+        "std  Z+2, r1                        \n\t" // slot of r1
+    );
+    saveCalleeContext();
+
+    // r28:r29 are saved now and survive the calls, so they keep the stack pointer of the process
+    __asm__ volatile(
+        "in   r28, __SP_L__                  \n\t"
+        "in   r29, __SP_H__                  \n\t"
+        "ldi  r24, lo8(%[isrStack])          \n\t"
+        "ldi  r25, hi8(%[isrStack])          \n\t"
+        "out  __SP_H__, r25                  \n\t"
+        "out  __SP_L__, r24                  \n\t"
+        "ldi  r24, 1                         \n\t" // voluntary
+        "call os_scheduleNext                \n\t"
+        "movw r24, r28                       \n\t"
+        "call os_dispatch                    \n\t"
+        "out  __SP_H__, r25                  \n\t"
+        "out  __SP_L__, r24                  \n\t"
+        :
+        : [isrStack] "i"(BOTTOM_OF_ISR_STACK));
+    restoreContext();
+}
+
+/*!
+ *  Opens the task manager once the buttons that opened it are released.
+ *  Runs as a deferred call, so the other interrupts keep being served.
+ */
+static void os_openTaskMan(void *arg) {
+    os_waitForNoInput();
+    os_taskManMain();
+}
+
+/*!
+ *  Runs the deferred calls on the scheduler's stack. Interrupts are enabled
+ *  meanwhile, but the scheduler is held off as in a critical section, since
+ *  it must not be entered again while its stack is in use.
+ */
+static void os_runDeferredCalls(void) {
+    const uint8_t timsk = TIMSK2;
+    criticalSectionCount++;
+    cbi(TIMSK2, OCIE2A);
+    os_inDeferredCalls = true;
+    sei();
+    os_runDeferred();
+    cli();
+    os_inDeferredCalls = false;
+    criticalSectionCount--;
+    TIMSK2 = timsk;
+}
+
+/*!
+ *  Polls the task manager, runs deferred calls and derives the next process with the active
+ *  strategy. Runs on the scheduler's stack while only the call-clobbered
+ *  registers of the current process are saved.
+ *
+ *  \param voluntary Whether the current process called os_yield.
+ *  \return SCHEDULE_CONTINUE if the current process continues, SCHEDULE_SWITCH or
+ *          SCHEDULE_DISCARD (if the current process was killed) if another one has to be resumed.
+ */
+uint8_t os_scheduleNext(bool voluntary) {
+    os_schedulerStart = os_systemTime_augment();
+    os_voluntarySwitch = voluntary;
+
+    // ENTER and ESC pressed at once open the task manager
+    if (os_getInput() == ((1 << 0) | (1 << 3))) {
+        os_defer(os_openTaskMan, NULL);
+    }
+
+    if (os_hasDeferred()) {
+        os_runDeferredCalls();
+        // Deferred work like browsing the task manager is not scheduler overhead
+        os_schedulerStart = os_systemTime_augment();
+    }
+
+    const Time nextWakeUp = os_wakeSleepers();
+
+    switch (currentStrategy) {
+        case OS_SS_EVEN: nextProc = os_Scheduler_Even(os_processes, currentProc); break;
+        case OS_SS_RANDOM: nextProc = os_Scheduler_Random(os_processes, currentProc); break;
+        case OS_SS_RUN_TO_COMPLETION: nextProc = os_Scheduler_RunToCompletion(os_processes, currentProc); break;
+        case OS_SS_ROUND_ROBIN: nextProc = os_Scheduler_RoundRobin(os_processes, currentProc); break;
+        case OS_SS_INACTIVE_AGING: nextProc = os_Scheduler_InactiveAging(os_processes, currentProc); break;
+        case OS_SS_EDF: nextProc = os_Scheduler_EDF(os_processes, currentProc); break;
+        case OS_SS_RATE_MONOTONIC: nextProc = os_Scheduler_RateMonotonic(os_processes, currentProc); break;
+    }
+
+    // There is nothing to preempt while only idle is ready, so the next tick is stretched up to the next wake-up
+    uint8_t compare = SCHEDULER_TICK;
+    os_tickStretched = !nextProc;
+    if (!nextProc) {
+        const Time countsPerRaw = TC0_PRESCALER * 256ul / TC2_PRESCALER;
+        compare = nextWakeUp < SCHEDULER_IDLE_TICK / countsPerRaw ? nextWakeUp * countsPerRaw : SCHEDULER_IDLE_TICK;
+    }
+    // Timer 2 kept counting since the compare match, e.g. during deferred calls. A compare value
+    // it already passed would only match after a wrap of the counter, i.e. a whole period late.
+    const uint8_t count = TCNT2;
+    if (compare <= count && count < UINT8_MAX) {
+        compare = count + 1;
+    }
+    OCR2A = compare;
+
+    // A killed process must not be resumed, even if a deferred call reused its slot
+    if (os_currentProcKilled) {
+        return SCHEDULE_DISCARD;
+    }
+    if (nextProc == currentProc && !voluntary) {
+        // The process continues right away, so os_dispatch will not account for this invocation
+        const Time spent = os_systemTime_augment() - os_schedulerStart;
+        os_schedulerStats.schedulerTime += spent;
+        os_runStart += spent;
+    }
+
+    return nextProc != currentProc ? SCHEDULE_SWITCH : SCHEDULE_CONTINUE;
+}
+
+/*!
+ *  Saves the stack pointer of the current process and updates its statistics
+ *  and stack check before it is left.
+ *
+ *  \param sp The stack pointer of the current process right below its saved context.
+ */
+static void os_suspend(uint16_t sp) {
+    os_processes[currentProc].sp.as_int = sp;
+
+    Process *const suspended = &os_processes[currentProc];
+    suspended->runTime += os_schedulerStart - os_runStart;
+    if (os_voluntarySwitch) {
+        suspended->yieldCount++;
+    } else if (suspended->state == OS_PS_RUNNING) {
+        suspended->preemptCount++;
+    }
+    if (suspended->stackBottom - sp > suspended->stackPeak) {
+        suspended->stackPeak = suspended->stackBottom - sp;
+    }
+#if OS_STACK_CHECK == OS_STACK_CHECK_CANARY
+    // Only the suspended process can have overflowed its stack
+    const uint16_t top = os_processes[currentProc].stackBottom - os_processes[currentProc].stackSize + 1;
+    if (sp < top + 1 || *(const uint16_t *)top != STACK_CANARY) {
+        os_error("Stack overflow");
+    }
+#else
+    os_processes[currentProc].checksum = os_getStackChecksum(currentProc);
+#endif
+
+    // The process may have been killed in the meantime, so only a running one becomes ready again.
+    // Both states are runnable, so the ready bitmap is not affected.
+    if (os_processes[currentProc].state == OS_PS_RUNNING) {
+        os_processes[currentProc].state = OS_PS_READY;
+    }
+}
+
+/*!
+ *  Suspends the current process and resumes the one chosen by os_scheduleNext.
+ *  Runs on the scheduler's stack once the complete context of the current
+ *  process has been saved.
+ *
+ *  \param sp The stack pointer of the current process right below its saved context, unused if it was killed.
+ *  \return The stack pointer of the process to resume.
+ */
+uint16_t os_dispatch(uint16_t sp) {
+    if (os_currentProcKilled) {
+        // The slot is unused or was already handed to a new process, so nothing is saved
+        os_currentProcKilled = false;
+    } else {
+        os_suspend(sp);
+    }
+
+    if (nextProc != currentProc) {
+        os_trace(TRACE_SWITCH, currentProc, nextProc);
+        os_schedulerStats.switchCount++;
+        os_processes[nextProc].scheduleCount++;
+    }
+    currentProc = nextProc;
+    os_processes[currentProc].state = OS_PS_RUNNING;
+
+#if OS_STACK_CHECK != OS_STACK_CHECK_CANARY
+    if (os_processes[currentProc].checksum != os_getStackChecksum(currentProc)) {
+        os_error("Stack inconsistent");
+    }
+#endif
+#if OS_STACK_CHECK == OS_STACK_CHECK_WINDOW
+    // The stack is about to change, so the idle process has to take a new full checksum
+    cbi(os_fullChecksumValid, currentProc);
+#endif
+
+    os_runStart = os_systemTime_augment();
+    os_schedulerStats.schedulerTime += os_runStart - os_schedulerStart;
+
+    return os_processes[currentProc].sp.as_int;
+}
+
+#if OS_STACK_CHECK == OS_STACK_CHECK_WINDOW
+/*!
+ *  Checks the parts of the stacks that os_dispatch does not cover. The first
+ *  call during a suspension of a process takes a checksum over its whole
+ *  stack, every later one compares against it.
+ */
+static void os_verifyStacks(void) {
+    for (ProcessID pid = 1; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+        os_enterCriticalSection();
+        const ProcessState state = os_processes[pid].state;
+        if (state == OS_PS_READY || state == OS_PS_BLOCKED) {
+            const StackChecksum checksum = os_checksumStackUpTo(pid, (const uint8_t *)os_processes[pid].stackBottom);
+            if (!gbi(os_fullChecksumValid, pid)) {
+                os_fullChecksum[pid] = checksum;
+                sbi(os_fullChecksumValid, pid);
+            } else if (os_fullChecksum[pid] != checksum) {
+                os_error("Stack inconsistent");
+            }
+        }
+        os_leaveCriticalSection();
+    }
+}
+#endif
+
+/*!
+ *  This is the idle program. It is started as process 0 and is only
+ *  scheduled if no other process is ready. Instead of spinning, it puts the
+ *  CPU to sleep until the next interrupt.
+ */
+void idle(void) {
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    while (1) {
+        lcd_writeChar('.');
+#if OS_STACK_CHECK == OS_STACK_CHECK_WINDOW
+        os_verifyStacks();
+#endif
+        const Time start = os_systemTime_raw();
+        const Time duration = os_systemTime_msToRaw(DEFAULT_OUTPUT_DELAY);
+        while (os_systemTime_raw() - start < duration) {
+#if OS_TRACE
+            os_traceFlush();
+#endif
+            sleep_mode();
+        }
+    }
+}
+
+/*!
+ *  Makes all sleeping processes whose wake-up time has passed ready again.
+ *
+ *  \return The raw time until the earliest remaining wake-up, UINT32_MAX if no process sleeps.
+ */
+static Time os_wakeSleepers(void) {
+    Time nextWakeUp = UINT32_MAX;
+    if (!os_sleepingMask) {
+        return nextWakeUp;
+    }
+
+    const Time now = os_systemTime_raw();
+    OS_UNROLL_PROCESSES
+    for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+        if (!gbi(os_sleepingMask, pid)) {
+            continue;
+        }
+        const Time remaining = os_wakeTime[pid] - now;
+        if (os_processes[pid].state != OS_PS_BLOCKED) {
+            // The slot was reused or modified externally
+            cbi(os_sleepingMask, pid);
+        } else if ((int32_t)remaining <= 0) {
+            cbi(os_sleepingMask, pid);
+            os_setProcessState(pid, OS_PS_READY);
+        } else if (remaining < nextWakeUp) {
+            nextWakeUp = remaining;
+        }
+    }
+    return nextWakeUp;
+}
+
+/*!
+ *  Rebuilds all bitmaps of a process mask from the given process array.
+ *
+ *  \param processes The process array to derive the bitmaps from.
+ *  \param mask The mask to fill.
+ */
+static void os_buildProcessMask(const Process processes[], ProcessMask *mask) {
+    *mask = (ProcessMask){0};
+    OS_UNROLL_PROCESSES
+    for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+        if (os_isRunnable(&processes[pid])) {
+            mask->ready |= 1 << pid;
+        }
+        const Priority priority = os_getEffectivePriority(&processes[pid]);
+        for (uint8_t bit = 0; bit < sizeof(mask->priority); bit++) {
+            if (gbi(priority, bit)) {
+                mask->priority[bit] |= 1 << pid;
+            }
+        }
+    }
+}
+
+/*!
+ *  Writes the priority of a process into the priority bit planes of the
+ *  kernel's process mask.
+ *
+ *  \param pid The process whose priority changed.
+ */
+static void os_updatePriorityMask(ProcessID pid) {
+    const Priority priority = os_getEffectivePriority(&os_processes[pid]);
+    for (uint8_t bit = 0; bit < sizeof(os_processMask.priority); bit++) {
+        if (gbi(priority, bit)) {
+            sbi(os_processMask.priority[bit], pid);
+        } else {
+            cbi(os_processMask.priority[bit], pid);
+        }
+    }
+}
+
+/*!
+ *  Returns the bitmap view of a process array. For the kernel's own process
+ *  table the incrementally maintained bitmaps are returned, any other array
+ *  (e.g. a copy handed to a strategy by a test) is scanned once.
+ *  Slots modified through os_getProcessSlot() are picked up by every lookup
+ *  until the next setter, as the write may still be pending.
+ *
+ *  \param processes The process array the bitmaps shall describe.
+ *  \return A pointer to the bitmaps, valid until the next call.
+ */
+const ProcessMask *os_getProcessMask(const Process processes[]) {
+    if (processes != os_processes) {
+        static ProcessMask foreignMask;
+        os_buildProcessMask(processes, &foreignMask);
+        return &foreignMask;
+    }
+    if (os_processMaskStale) {
+        os_buildProcessMask(os_processes, &os_processMask);
+    }
+    return &os_processMask;
+}
+
+/*!
+ *  Brings the bitmaps up to date with slots modified through os_getProcessSlot()
+ *  before a setter changes them incrementally. Writes through slots handed out
+ *  earlier are expected to be done by then, so the bitmaps are valid again afterwards.
+ */
+static void os_syncProcessMask(void) {
+    if (os_processMaskStale) {
+        os_processMaskStale = false;
+        os_buildProcessMask(os_processes, &os_processMask);
+    }
+}
+
+/*!
+ *  Pulls the next scheduler tick back to at most SCHEDULER_TICK counts from
+ *  now, so a process made ready (e.g. by an ISR) while the idle process runs
+ *  on a stretched tick does not wait for the whole stretch.
+ *  Must be called with the scheduler held off.
+ */
+static void os_shortenTick(void) {
+    os_tickStretched = false;
+    const uint16_t compare = TCNT2 + SCHEDULER_TICK;
+    if (compare < OCR2A) {
+        OCR2A = compare;
+    }
+}
+
+/*!
+ *  Changes the state of a process. Kernel code must use this instead of
+ *  writing the state directly in order to keep the ready bitmap in sync.
+ *
+ *  \param pid The process to change.
+ *  \param state The new state of the process.
+ */
+void os_setProcessState(ProcessID pid, ProcessState state) {
+    os_syncProcessMask();
+#if OS_TRACE
+    if (state == OS_PS_BLOCKED) {
+        os_trace(TRACE_BLOCK, pid, 0);
+    } else if (os_processes[pid].state == OS_PS_BLOCKED) {
+        os_trace(TRACE_UNBLOCK, pid, 0);
+    }
+#endif
+    os_processes[pid].state = state;
+    if (os_isRunnable(&os_processes[pid])) {
+        sbi(os_processMask.ready, pid);
+        if (pid && os_tickStretched) {
+            os_shortenTick();
+        }
+    } else {
+        cbi(os_processMask.ready, pid);
+    }
+}
+
+/*!
+ *  Sets the priority a process inherits from the processes waiting for its
+ *  mutexes and keeps the priority bit planes in sync.
+ *
+ *  \param pid The process holding the mutexes.
+ *  \param priority The inherited priority, 0 to fall back to the own priority.
+ */
+void os_setInheritedPriority(ProcessID pid, Priority priority) {
+    os_syncProcessMask();
+    os_processes[pid].inheritedPriority = priority;
+    os_updatePriorityMask(pid);
+}
+
+/*!
+ *  Changes the priority of a process and keeps the priority bit planes in sync.
+ *
+ *  \param pid The process to change.
+ *  \param priority The new priority of the process.
+ */
+void os_setProcessPriority(ProcessID pid, Priority priority) {
+    os_enterCriticalSection();
+    os_syncProcessMask();
+    os_processes[pid].priority = priority;
+    os_updatePriorityMask(pid);
+    os_leaveCriticalSection();
+}
+
+/*!
+ *  Looks for a used process whose stack intersects the given memory.
+ *
+ *  \param bottom The highest address of the memory.
+ *  \param size The number of bytes of the memory.
+ *  \return The id of such a process or INVALID_PROCESS if the memory is free.
+ */
+static ProcessID os_findStackCollision(uint16_t bottom, StackSize size) {
+    for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+        const Process *const process = &os_processes[pid];
+        if (process->state == OS_PS_UNUSED || !process->stackSize) {
+            continue;
+        }
+        if (bottom - size < process->stackBottom && process->stackBottom - process->stackSize < bottom) {
+            return pid;
+        }
+    }
+    return INVALID_PROCESS;
+}
+
+/*!
+ *  Finds memory for the stack of a new process. A stack that fits into the
+ *  chunk PROCESS_STACK_BOTTOM(pid) is put there if no other process uses it.
+ *  Otherwise the first gap that is large enough is taken, searching from the
+ *  bottom of the region of all process stacks. As the stacks are kept in the
+ *  process table, memory of terminated processes is reused right away.
+ *
+ *  \param pid The id of the new process.
+ *  \param size The requested number of bytes.
+ *  \return The highest address of the stack or 0 if there is no gap left.
+ */
+static uint16_t os_allocStack(ProcessID pid, StackSize size) {
+    if (size <= STACK_SIZE_PROC && os_findStackCollision(PROCESS_STACK_BOTTOM(pid), size) == INVALID_PROCESS) {
+        return PROCESS_STACK_BOTTOM(pid);
+    }
+
+    // Move upwards past every stack in the way, each step lowers the bottom
+    uint16_t bottom = BOTTOM_OF_PROCS_STACK;
+    ProcessID other;
+    while ((other = os_findStackCollision(bottom, size)) != INVALID_PROCESS) {
+        bottom = os_processes[other].stackBottom - os_processes[other].stackSize;
+    }
+    return bottom + 1 - TOP_OF_PROCS_STACK >= size ? bottom : 0;
+}
+
+/*!
+ *  This function is used to start a new process executing the given program.
+ *  A stack of STACK_SIZE_PROC bytes will be provided if the process limit
+ *  has not yet been reached, see os_execWithStack.
+ *  This function is multitasking safe. That means that programs can repost
+ *  other programs during their runtime.
+ *
+ *  \param program  The function of the program to start.
+ *  \param priority A priority ranging 0..255 for the new process:
+ *                   - 0 means least favourable
+ *                   - 255 means most favourable
+ *                  Note that the priority may be ignored by certain scheduling
+ *                  strategies.
+ *  \return The index of the new process or INVALID_PROCESS as specified in
+ *          defines.h on failure
+ */
+ProcessID os_exec(Program *program, Priority priority) {
+    return os_execWithStack(program, priority, STACK_SIZE_PROC);
+}
+
+/*!
+ *  Starts a new process like os_exec, but with a stack of the given size.
+ *  Small programs can save memory this way, which gives deeply nested ones
+ *  (e.g. using printf) the chance to ask for more than STACK_SIZE_PROC bytes.
+ *
+ *  \param program   The function of the program to start.
+ *  \param priority  The priority of the new process, see os_exec.
+ *  \param stackSize The stack size in bytes, at least STACK_SIZE_PROC_MIN.
+ *  \return The index of the new process or INVALID_PROCESS if there is no
+ *          free slot or not enough memory for the stack.
+ */
+ProcessID os_execWithStack(Program *program, Priority priority, StackSize stackSize) {
+    if (!program || stackSize < STACK_SIZE_PROC_MIN) {
+        return INVALID_PROCESS;
+    }
+
+    os_enterCriticalSection();
+
+    // Find the first free process slot
+    ProcessID pid = 0;
+    while (pid < MAX_NUMBER_OF_PROCESSES && os_processes[pid].state != OS_PS_UNUSED) {
+        pid++;
+    }
+    if (pid == MAX_NUMBER_OF_PROCESSES) {
+        os_leaveCriticalSection();
+        return INVALID_PROCESS;
+    }
+
+    const uint16_t stackBottom = os_allocStack(pid, stackSize);
+    if (!stackBottom) {
+        os_leaveCriticalSection();
+        return INVALID_PROCESS;
+    }
+
+    Process *const process = &os_processes[pid];
+    process->program = program;
+    process->priority = priority;
+    process->stackBottom = stackBottom;
+    process->stackSize = stackSize;
+    process->runTime = 0;
+    process->scheduleCount = 0;
+    process->preemptCount = 0;
+    process->yieldCount = 0;
+    process->stackPeak = 0;
+    process->inheritedPriority = 0;
+    process->heldMutexes = 0;
+    process->blockedOn = NULL;
+    os_eventFlags[pid] = 0;
+    os_eventWaitMask[pid] = 0;
+    cbi(os_periodicMask, pid);
+
+    // Paint the whole stack, so os_getStackHighWater can tell which bytes were ever used
+    memset((uint8_t *)(stackBottom - stackSize + 1), STACK_PAINT, stackSize);
+
+    // Prepare the stack such that restoreContext returns into the program
+    StackPointer sp = {.as_int = stackBottom};
+    *(sp.as_ptr--) = (uint16_t)program & 0xFF;
+    *(sp.as_ptr--) = (uint16_t)program >> 8;
+
+    // 32 registers and SREG start zeroed
+    for (uint8_t i = 0; i < 33; i++) {
+        *(sp.as_ptr--) = 0;
+    }
+    process->sp = sp;
+    process->checksum = os_getStackChecksum(pid);
+#if OS_STACK_CHECK == OS_STACK_CHECK_WINDOW
+    cbi(os_fullChecksumValid, pid);
+#elif OS_STACK_CHECK == OS_STACK_CHECK_CANARY
+    *(uint16_t *)(stackBottom - stackSize + 1) = STACK_CANARY;
+#endif
+
+    os_resetProcessSchedulingInformation(pid);
+    os_updatePriorityMask(pid);
+    os_setProcessState(pid, OS_PS_READY);
+    os_trace(TRACE_EXEC, pid, priority);
+
+    os_leaveCriticalSection();
+    return pid;
+}
+
+/*!
+ *  Terminates a process. The idle process cannot be killed. If a process
+ *  kills itself, this function does not return. A deferred call that kills
+ *  the interrupted process returns normally, the scheduler then resumes
+ *  another process once the deferred calls are done.
+ *
+ *  \param pid The id of the process to terminate.
+ *  \return True iff the process was terminated.
+ */
+bool os_kill(ProcessID pid) {
+    os_enterCriticalSection();
+
+    if (pid == 0 || pid >= MAX_NUMBER_OF_PROCESSES || os_processes[pid].state == OS_PS_UNUSED) {
+        os_leaveCriticalSection();
+        return false;
+    }
+
+    os_trace(TRACE_KILL, pid, currentProc);
+    os_setProcessState(pid, OS_PS_UNUSED);
+    cbi(os_sleepingMask, pid);
+    cbi(os_periodicMask, pid);
+    os_eventFlags[pid] = 0;
+    os_eventWaitMask[pid] = 0;
+    os_dropInputWaiter(pid);
+
+    if (pid == currentProc && os_inDeferredCalls) {
+        // Deferred calls run on the scheduler's stack, which picks someone else once they are done
+        os_currentProcKilled = true;
+    } else if (pid == currentProc) {
+        // Drop all critical sections and wait for the scheduler to pick someone else
+        criticalSectionCount = 1;
+        os_leaveCriticalSection();
+        HALT;
+    }
+
+    os_leaveCriticalSection();
+    return true;
+}
+
+/*!
+ *  Blocks the current process until the given raw system time. The scheduler
+ *  skips it until then and makes it ready again on the first tick after its
+ *  wake-up time. As the idle process must always be ready and the scheduler is
+ *  off inside critical sections, this busy waits in those cases.
+ *
+ *  \param wakeTime The raw system time to wake up at, see os_systemTime_raw().
+ */
+static void os_sleepUntil(Time wakeTime) {
+    if (currentProc == 0 || criticalSectionCount) {
+        while ((int32_t)(wakeTime - os_systemTime_raw()) > 0) {
+            continue;
+        }
+        return;
+    }
+
+    // Someone else may make the process ready early, e.g. the task manager, so it blocks again until its time has come
+    do {
+        os_enterCriticalSection();
+        os_wakeTime[currentProc] = wakeTime;
+        sbi(os_sleepingMask, currentProc);
+        os_setProcessState(currentProc, OS_PS_BLOCKED);
+        os_leaveCriticalSection();
+
+        // If the scheduler preempted us right after leaving the critical section, this merely yields once more
+        os_yield();
+    } while ((int32_t)(wakeTime - os_systemTime_raw()) > 0);
+}
+
+/*!
+ *  Blocks the current process for (at least) the given time, see os_sleepUntil.
+ *
+ *  \param ms The time to sleep in milliseconds.
+ */
+void os_sleep(Time ms) {
+    os_sleepUntil(os_systemTime_raw() + os_systemTime_msToRaw(ms));
+}
+
+/*!
+ *  Turns the current process into a periodic one. The first call starts the
+ *  period, every call blocks until the next release. Releases are placed on a
+ *  fixed grid, so the time the process needs between two calls does not drift
+ *  the period. Releases that already passed due to an overrun are skipped.
+ *  The period and the deadline of every job are passed on to the deadline
+ *  aware strategies, the call itself completes the current job.
+ *
+ *  \param ms The period in milliseconds, which should stay the same between calls.
+ */
+void os_waitPeriod(Time ms) {
+    const Time period = os_systemTime_msToRaw(ms);
+
+    os_enterCriticalSection();
+    const Time now = os_systemTime_raw();
+    if (!gbi(os_periodicMask, currentProc)) {
+        sbi(os_periodicMask, currentProc);
+        os_nextRelease[currentProc] = now;
+    } else {
+        os_completeJob(currentProc, now);
+    }
+    Time release = os_nextRelease[currentProc] + period;
+    if (period && (int32_t)(release - now) <= 0) {
+        release += ((now - release) / period + 1) * period;
+    }
+    os_nextRelease[currentProc] = release;
+    os_releaseJob(currentProc, release, period);
+    os_leaveCriticalSection();
+
+    os_sleepUntil(release);
+}
+
+/*!
+ *  Returns whether the current process may be blocked. This is not the case
+ *  for the idle process, inside critical sections and while interrupts are
+ *  disabled (e.g. in ATOMIC blocks, in ISRs or before the scheduler runs).
+ *
+ *  \return True iff the current process can give up the processor until it is woken up.
+ */
+bool os_canBlock(void) {
+    return currentProc != 0 && !criticalSectionCount && gbi(SREG, SREG_I);
+}
+
+/*!
+ *  Waits until at least one of the given events was signaled to the current
+ *  process by os_signalEvent. Meanwhile, the process is blocked and skipped by
+ *  every strategy. Events that were signaled before the call are taken right
+ *  away. If the process cannot block (see os_canBlock), this busy waits.
+ *
+ *  \param mask The events to wait for.
+ *  \return The signaled events out of mask, which are cleared.
+ */
+EventMask os_waitEvent(EventMask mask) {
+    const bool block = os_canBlock();
+    while (1) {
+        const uint8_t sreg = SREG;
+        cli();
+        const EventMask events = os_eventFlags[currentProc] & mask;
+        if (events) {
+            os_eventFlags[currentProc] &= ~events;
+            SREG = sreg;
+            return events;
+        }
+        if (block) {
+            os_eventWaitMask[currentProc] = mask;
+            os_setProcessState(currentProc, OS_PS_BLOCKED);
+        }
+        SREG = sreg;
+
+        if (block) {
+            // If the scheduler preempted us right after restoring the SREG, this merely yields once more
+            os_yield();
+        } else if (!gbi(sreg, SREG_I)) {
+            os_error("Event wait without interrupts");
+            return 0;
+        }
+    }
+}
+
+/*!
+ *  Signals events to a process and makes it ready if it waits for one of
+ *  them. May also be called from an ISR.
+ *
+ *  \param pid The process to signal.
+ *  \param mask The events to signal.
+ */
+void os_signalEvent(ProcessID pid, EventMask mask) {
+    if (pid >= MAX_NUMBER_OF_PROCESSES) {
+        return;
+    }
+
+    const uint8_t sreg = SREG;
+    cli();
+    os_eventFlags[pid] |= mask;
+    if ((os_eventWaitMask[pid] & mask) && os_processes[pid].state == OS_PS_BLOCKED) {
+        os_eventWaitMask[pid] = 0;
+        os_setProcessState(pid, OS_PS_READY);
+    }
+    SREG = sreg;
+}
+
+/*!
+ *  If all processes have been registered for execution, the OS calls this
+ *  function to start the idle program and the concurrent execution of the
+ *  applications.
+ */
+void os_startScheduler(void) {
+    currentProc = 0;
+    os_setProcessState(currentProc, OS_PS_RUNNING);
+    os_runStart = os_systemTime_augment();
+    SP = os_processes[currentProc].sp.as_int;
+    restoreContext();
+}
+
+/*!
+ *  In order for the Scheduler to work properly, it must have the chance to
+ *  initialize its internal data-structures and register.
+ */
+void os_initScheduler(void) {
+    for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+        os_processes[pid].state = OS_PS_UNUSED;
+    }
+    os_buildProcessMask(os_processes, &os_processMask);
+
+    // The idle process always gets id 0
+    os_execWithStack(idle, DEFAULT_PRIORITY, STACK_SIZE_IDLE);
+
+    for (struct program_linked_list_node *node = autostart_head; node; node = node->next) {
+        os_execWithStack(node->program, DEFAULT_PRIORITY, node->stackSize);
+    }
+
+    for (const AutostartEntry *entry = __autostart_start; entry < __autostart_end; entry++) {
+        os_execWithStack((Program *)pgm_read_word(&entry->program), pgm_read_byte(&entry->priority), pgm_read_word(&entry->stackSize));
+    }
+}
+
+/*!
+ *  A simple getter for the slot of a specific process.
+ *  As the caller may modify the slot, the process bitmaps are rebuilt on every
+ *  lookup until the next call of a setter like os_setProcessState. Kernel code
+ *  changes slots through those setters instead.
+ *
+ *  \param pid The processID of the process to be handled
+ *  \return A pointer to the memory of the process at position pid in the os_processes array.
+ */
+Process *os_getProcessSlot(ProcessID pid) {
+    os_processMaskStale = true;
+    return os_processes + pid;
+}
+
+/*!
+ *  Returns the id of the currently running process.
+ *
+ *  \return The id of the currently running process.
+ */
+ProcessID os_getCurrentProc(void) {
+    return currentProc;
+}
+
+/*!
+ *  Sets the current scheduling strategy. If OS_FIXED_STRATEGY is defined,
+ *  other strategies are ignored.
+ *
+ *  \param strategy The strategy that will be used after the function finishes.
+ */
+void os_setSchedulingStrategy(SchedulingStrategy strategy) {
+#ifdef OS_FIXED_STRATEGY
+    if (strategy != currentStrategy) {
+        return;
+    }
+#else
+    currentStrategy = strategy;
+#endif
+    os_resetSchedulingInformation(strategy);
+}
+
+/*!
+ *  This is a getter for retrieving the current scheduling strategy.
+ *
+ *  \return The current scheduling strategy.
+ */
+SchedulingStrategy os_getSchedulingStrategy(void) {
+    return currentStrategy;
+}
+
+/*!
+ *  Enters a critical code section by disabling the scheduler if needed.
+ *  This function stores the nesting depth of critical sections of the current
+ *  process (e.g. if a function with a critical section is called from another
+ *  critical section) to ensure correct behaviour when leaving the section.
+ *  This function supports up to 255 nested critical sections.
+ */
+__attribute__((noinline)) void os_enterCriticalSection(void) {
+    // Save the global interrupt enable bit and turn interrupts off
+    const uint8_t gieb = SREG & (1 << 7);
+    cli();
+
+    if (criticalSectionCount == UINT8_MAX) {
+        os_error("Too many nested critical sections");
+    } else if (!criticalSectionCount++) {
+        os_trace(TRACE_CRITICAL_ENTER, currentProc, 0);
+        os_criticalStart = os_systemTime_augment();
+#if OS_CRITICAL_STATS
+        os_criticalPc = (uint16_t)__builtin_return_address(0);
+#endif
+    }
+
+    // Deactivate the scheduler
+    cbi(TIMSK2, OCIE2A);
+
+    SREG |= gieb;
+}
+
+/*!
+ *  Leaves a critical code section by enabling the scheduler if needed.
+ *  This function utilizes the nesting depth of critical sections
+ *  stored by os_enterCriticalSection to check if the scheduler
+ *  has to be reactivated.
+ */
+void os_leaveCriticalSection(void) {
+    // Save the global interrupt enable bit and turn interrupts off
+    const uint8_t gieb = SREG & (1 << 7);
+    cli();
+
+    if (!criticalSectionCount) {
+        os_error("No critical section to leave");
+    } else if (!--criticalSectionCount) {
+        // Reactivate the scheduler once the outermost section is left
+        sbi(TIMSK2, OCIE2A);
+        os_schedulerStats.criticalTime += os_systemTime_augment() - os_criticalStart;
+        os_trace(TRACE_CRITICAL_LEAVE, currentProc, 0);
+#if OS_CRITICAL_STATS
+        os_recordCriticalHold(os_criticalStart, os_criticalPc);
+#endif
+    }
+
+    SREG |= gieb;
+}
+
+/*!
+ *  Calculates the XOR over the bytes of a stack from right below the stack
+ *  pointer of the process up to the given address.
+ *
+ *  \param pid The ProcessID of the process whose stack is used.
+ *  \param bottom The last address to include.
+ *  \return The checksum of that part of the stack.
+ */
+static StackChecksum os_checksumStackUpTo(ProcessID pid, const uint8_t *bottom) {
+    StackChecksum checksum = 0;
+    for (const uint8_t *ptr = os_processes[pid].sp.as_ptr + 1; ptr <= bottom; ptr++) {
+        checksum ^= *ptr;
+    }
+    return checksum;
+}
+
+/*!
+ *  Calculates the checksum of the stack for the corresponding process of pid.
+ *  The checksum is the XOR over all bytes from the top of the stack up to its bottom.
+ *  If OS_STACK_CHECK is OS_STACK_CHECK_WINDOW, it only covers the 35 bytes of
+ *  a saved context and STACK_CHECK_WINDOW more, so its cost does not grow
+ *  with the depth of the stack.
+ *
+ *  \param pid The ProcessID of the process for which the stack's checksum has to be calculated.
+ *  \return The checksum of the pid'th stack.
+ */
+StackChecksum os_getStackChecksum(ProcessID pid) {
+    const uint8_t *bottom = (const uint8_t *)os_processes[pid].stackBottom;
+#if OS_STACK_CHECK == OS_STACK_CHECK_WINDOW
+    const uint8_t *const windowEnd = os_processes[pid].sp.as_ptr + 35 + STACK_CHECK_WINDOW;
+    if (windowEnd < bottom) {
+        bottom = windowEnd;
+    }
+#endif
+    return os_checksumStackUpTo(pid, bottom);
+}
+
+/*!
+ *  Returns the deepest stack usage of a process since it was started. As
+ *  os_exec paints the stack with STACK_PAINT, this is the distance from the
+ *  bottom of the stack to the topmost byte that no longer holds the paint.
+ *  Unlike stackPeak in Process, this also catches usage between two
+ *  context switches, e.g. by interrupts. A byte that happens to be written
+ *  with STACK_PAINT may make the result slightly too small.
+ *
+ *  \param pid The ProcessID of the process whose stack is scanned.
+ *  \return The high-water mark in bytes, 0 for unused process slots.
+ */
+StackSize os_getStackHighWater(ProcessID pid) {
+    const Process *const process = &os_processes[pid];
+    if (process->state == OS_PS_UNUSED) {
+        return 0;
+    }
+    const uint8_t *const bottom = (const uint8_t *)process->stackBottom;
+    const uint8_t *address = bottom - process->stackSize + 1;
+#if OS_STACK_CHECK == OS_STACK_CHECK_CANARY
+    // The canary is not part of the paint
+    address += sizeof(uint16_t);
+#endif
+    while (address <= bottom && *address == STACK_PAINT) {
+        address++;
+    }
+    return bottom - address + 1;
+}
+
+/*!
+ *  Returns the counters of the scheduler. Multiply times by TC0_PRESCALER to
+ *  get cycles. Together with the counters in Process, this shows where the
+ *  processor time goes.
+ *
+ *  \return A pointer to the counters, which keep changing while processes run.
+ */
+const SchedulerStats *os_getSchedulerStats(void) {
+    return &os_schedulerStats;
+}
+
+/*!
+ *  Resets the counters of the scheduler and the run time, scheduling and
+ *  stack counters of all processes. With OS_CRITICAL_STATS, the hold times of
+ *  critical sections are reset as well.
+ */
+void os_resetStats(void) {
+    os_enterCriticalSection();
+    os_schedulerStats = (SchedulerStats){0};
+    for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+        os_processes[pid].runTime = 0;
+        os_processes[pid].scheduleCount = 0;
+        os_processes[pid].preemptCount = 0;
+        os_processes[pid].yieldCount = 0;
+        os_processes[pid].stackPeak = 0;
+    }
+#if OS_CRITICAL_STATS
+    os_resetCriticalStats();
+#endif
+    os_leaveCriticalSection();
+}
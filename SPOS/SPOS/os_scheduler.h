@@ -0,0 +1,147 @@
+/*! \file
+ *  \brief Scheduling module for the OS.
+ *
+ *  Contains everything needed to realise the scheduling between multiple processes.
+ *  Also contains functions to start the execution of programs.
+ *
+ *  \author   Lehrstuhl Informatik 11 - RWTH Aachen
+ *  \date     2013
+ *  \version  2.0
+ */
+
+#ifndef _OS_SCHEDULER_H
+#define _OS_SCHEDULER_H
+
+#include "defines.h"
+#include "os_process.h"
+#include "util.h"
+
+#include <avr/interrupt.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! Type of a scheduling strategy
+typedef enum {
+    OS_SS_EVEN,
+    OS_SS_RANDOM,
+    OS_SS_RUN_TO_COMPLETION,
+    OS_SS_ROUND_ROBIN,
+    OS_SS_INACTIVE_AGING,
+    OS_SS_EDF,
+    OS_SS_RATE_MONOTONIC
+} SchedulingStrategy;
+
+/*!
+ *  Bitmap view of a process array. Bit n of every member refers to the process
+ *  with id n, which is why MAX_NUMBER_OF_PROCESSES may not exceed 8.
+ */
+typedef struct {
+    //! Processes that are ready or running
+    uint8_t ready;
+    //! Priorities sliced into bit planes: bit n of priority[b] is bit b of the priority of process n
+    uint8_t priority[sizeof(Priority) * 8];
+} ProcessMask;
+
+//! A set of events, see os_waitEvent
+typedef uint8_t EventMask;
+
+//! Event reserved for the wake-up of processes waiting for the buttons
+#define OS_EVENT_INPUT (1 << 7)
+
+//! Counters of the scheduler as a whole, the per process counters are part of Process
+typedef struct {
+    //! Time spent in the scheduler (interrupt and os_yield) in os_systemTime_augment() ticks of TC0_PRESCALER cycles
+    uint32_t schedulerTime;
+    //! Time the scheduler was held off by critical sections in os_systemTime_augment() ticks
+    uint32_t criticalTime;
+    //! Number of switches between two different processes
+    uint32_t switchCount;
+} SchedulerStats;
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! The scheduler, may also be called directly to give up the processor
+ISR(TIMER2_COMPA_vect);
+
+//! Starts a new process
+ProcessID os_exec(Program *program, Priority priority);
+
+//! Starts a new process with a stack of the given size
+ProcessID os_execWithStack(Program *program, Priority priority, StackSize stackSize);
+
+//! Terminates a process
+bool os_kill(ProcessID pid);
+
+//! Starts the scheduler
+void os_startScheduler(void);
+
+//! Voluntarily hands the processor to the next process
+void os_yield(void);
+
+//! Blocks the current process for some milliseconds
+void os_sleep(Time ms);
+
+//! Blocks the current process until its next periodic release
+void os_waitPeriod(Time ms);
+
+//! Returns whether the current process may be blocked
+bool os_canBlock(void);
+
+//! Blocks the current process until one of the given events is signaled
+EventMask os_waitEvent(EventMask mask);
+
+//! Signals events to a process, may be called from ISRs
+void os_signalEvent(ProcessID pid, EventMask mask);
+
+//! Initializes scheduler arrays
+void os_initScheduler(void);
+
+//! Returns a pointer to the process structure of the given process
+Process *os_getProcessSlot(ProcessID pid);
+
+//! Returns the id of the currently running process
+ProcessID os_getCurrentProc(void);
+
+//! Changes the state of a process and keeps the ready bitmap in sync
+void os_setProcessState(ProcessID pid, ProcessState state);
+
+//! Changes the inherited priority of a process and keeps the priority bitmaps in sync
+void os_setInheritedPriority(ProcessID pid, Priority priority);
+
+//! Changes the priority of a process and keeps the priority bitmaps in sync
+void os_setProcessPriority(ProcessID pid, Priority priority);
+
+//! Returns the bitmap view of the given process array
+const ProcessMask *os_getProcessMask(const Process processes[]);
+
+//! Changes the scheduling strategy
+void os_setSchedulingStrategy(SchedulingStrategy strategy);
+
+//! Returns the current scheduling strategy
+SchedulingStrategy os_getSchedulingStrategy(void);
+
+//! Enters a critical code section
+void os_enterCriticalSection(void);
+
+//! Leaves a critical code section
+void os_leaveCriticalSection(void);
+
+//! Calculates the checksum of the stack for the corresponding process of pid.
+StackChecksum os_getStackChecksum(ProcessID pid);
+
+//! Returns the deepest stack usage of a process in bytes, measured by stack painting
+StackSize os_getStackHighWater(ProcessID pid);
+
+//! Returns the counters of the scheduler
+const SchedulerStats *os_getSchedulerStats(void);
+
+//! Resets the counters of the scheduler and of all processes
+void os_resetStats(void);
+
+#endif
@@ -3,20 +3,147 @@
 Scheduling strategies used by the Interrupt Service RoutineA from Timer 2 (in scheduler.c)
 to determine which process may continue its execution next.
 
-The file contains five strategies:
+The file contains seven strategies:
 -even
 -random
 -round-robin
 -inactive-aging
 -run-to-completion
+-earliest-deadline-first
+-rate-monotonic
+
+The strategies work on the bitmap view of the process array (see os_getProcessMask)
+and pick the next process with table based bit-scans instead of looping over all slots.
 */
 
 #include "os_scheduling_strategies.h"
 
 #include "defines.h"
+#include "util.h"
 
+#include <avr/pgmspace.h>
 #include <stdlib.h>
 
+//! The scheduling information of all strategies
+static SchedulingInformation schedulingInfo;
+
+//! Bit of the idle process in a process mask
+#define IDLE_MASK (1 << 0)
+
+//! Index of the lowest set bit of every nibble (entry 0 is never used)
+static const uint8_t lowestBitOfNibble[16] PROGMEM = {0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0};
+
+//! Number of set bits of every nibble
+static const uint8_t bitsInNibble[16] PROGMEM = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+#if OS_RANDOM_XORSHIFT
+//! Index of the k-th lowest set bit of every nibble (unused entries are 0)
+static const uint8_t selectBitOfNibble[16][4] PROGMEM = {
+    {0, 0, 0, 0}, {0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0},
+    {2, 0, 0, 0}, {0, 2, 0, 0}, {1, 2, 0, 0}, {0, 1, 2, 0},
+    {3, 0, 0, 0}, {0, 3, 0, 0}, {1, 3, 0, 0}, {0, 1, 3, 0},
+    {2, 3, 0, 0}, {0, 2, 3, 0}, {1, 2, 3, 0}, {0, 1, 2, 3}};
+
+//! State of the xorshift generator of the random strategy, never 0
+static uint16_t randomState = 1;
+#endif
+
+/*!
+ *  Bit-scan of a process mask in constant time.
+ *
+ *  \param mask A non-empty process mask.
+ *  \return The lowest ProcessID contained in the mask.
+ */
+static ProcessID lowestPid(uint8_t mask) {
+    if (mask & 0x0F) {
+        return pgm_read_byte(&lowestBitOfNibble[mask & 0x0F]);
+    }
+    return 4 + pgm_read_byte(&lowestBitOfNibble[mask >> 4]);
+}
+
+/*!
+ *  Counts the processes contained in a process mask.
+ *
+ *  \param mask The process mask.
+ *  \return The number of set bits.
+ */
+static uint8_t countPids(uint8_t mask) {
+    return pgm_read_byte(&bitsInNibble[mask & 0x0F]) + pgm_read_byte(&bitsInNibble[mask >> 4]);
+}
+
+#if OS_RANDOM_XORSHIFT
+/*!
+ *  Bit-scan for the k-th process of a process mask in constant time.
+ *
+ *  \param mask The process mask.
+ *  \param k The index of the process, less than countPids(mask).
+ *  \return The k-th lowest ProcessID contained in the mask.
+ */
+static ProcessID selectPid(uint8_t mask, uint8_t k) {
+    const uint8_t inLowNibble = pgm_read_byte(&bitsInNibble[mask & 0x0F]);
+    if (k < inLowNibble) {
+        return pgm_read_byte(&selectBitOfNibble[mask & 0x0F][k]);
+    }
+    return 4 + pgm_read_byte(&selectBitOfNibble[mask >> 4][k - inLowNibble]);
+}
+
+/*!
+ *  Advances the 16 bit xorshift generator (shifts 7, 9, 8), which only needs
+ *  byte moves and a few shifts on the AVR.
+ *
+ *  \return The next pseudo random number.
+ */
+static uint16_t nextRandom(void) {
+    randomState ^= randomState << 7;
+    randomState ^= randomState >> 9;
+    randomState ^= randomState << 8;
+    return randomState;
+}
+
+/*!
+ *  Seeds the generator of the random strategy.
+ *
+ *  \param seed The new state, 0 is replaced by 1 as the generator would get stuck.
+ */
+void os_seedRandom(uint16_t seed) {
+    randomState = seed ? seed : 1;
+}
+#endif
+
+/*!
+ *  Returns the process that follows current in cyclic order of ids.
+ *
+ *  \param candidates The processes to choose from.
+ *  \param current The id to start searching after.
+ *  \return The next candidate after current, or 0 (idle) if there is none.
+ */
+static ProcessID nextPidAfter(uint8_t candidates, ProcessID current) {
+    if (!candidates) {
+        return 0;
+    }
+    const uint8_t later = candidates & (uint8_t)(0xFE << current);
+    return lowestPid(later ? later : candidates);
+}
+
+/*!
+ *  Narrows a set of processes down to those with the highest priority by
+ *  walking the priority bit planes from the most significant bit downwards.
+ *
+ *  \param mask The bitmaps holding the priority bit planes.
+ *  \param candidates A non-empty set of processes.
+ *  \return The non-empty subset of candidates that share the highest priority.
+ */
+static uint8_t highestPriorityPids(const ProcessMask *mask, uint8_t candidates) {
+    uint8_t bit = sizeof(mask->priority);
+    while (bit--) {
+        const uint8_t higher = candidates & mask->priority[bit];
+        if (higher) {
+            candidates = higher;
+        }
+    }
+    return candidates;
+}
+
 /*!
  *  Reset the scheduling information for a specific strategy
  *  This is only relevant for RoundRobin and InactiveAging
@@ -25,7 +152,18 @@ The file contains five strategies:
  *  \param strategy  The strategy to reset information for
  */
 void os_resetSchedulingInformation(SchedulingStrategy strategy) {
-    // This is a presence task
+    switch (strategy) {
+        case OS_SS_ROUND_ROBIN:
+            schedulingInfo.timeSlice = os_getEffectivePriority(os_getProcessSlot(os_getCurrentProc()));
+            break;
+        case OS_SS_INACTIVE_AGING:
+            for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+                schedulingInfo.age[pid] = 0;
+            }
+            break;
+        default:
+            break;
+    }
 }
 
 /*!
@@ -36,7 +174,82 @@ void os_resetSchedulingInformation(SchedulingStrategy strategy) {
  *  \param id  The process slot to erase state for
  */
 void os_resetProcessSchedulingInformation(ProcessID id) {
-    // This is a presence task
+    schedulingInfo.age[id] = 0;
+    schedulingInfo.period[id] = 0;
+    schedulingInfo.relativeDeadline[id] = 0;
+    schedulingInfo.deadline[id] = 0;
+    schedulingInfo.deadlineMisses[id] = 0;
+}
+
+/*!
+ *  Sets the deadline of the jobs of a process relative to their release. By
+ *  default, a job has to complete before the next one is released.
+ *
+ *  \param id  The process to set the deadline for
+ *  \param ms  The relative deadline in ms, 0 to use the period
+ */
+void os_setRelativeDeadline(ProcessID id, Time ms) {
+    const Time deadline = os_systemTime_msToRaw(ms);
+    os_enterCriticalSection();
+    schedulingInfo.relativeDeadline[id] = deadline;
+    os_leaveCriticalSection();
+}
+
+/*!
+ *  Returns how many jobs of a process completed after their deadline.
+ *
+ *  \param id  The process to look up
+ *  \return The number of missed deadlines, which saturates at UINT16_MAX
+ */
+uint16_t os_getDeadlineMisses(ProcessID id) {
+    os_enterCriticalSection();
+    const uint16_t misses = schedulingInfo.deadlineMisses[id];
+    os_leaveCriticalSection();
+    return misses;
+}
+
+/*!
+ *  Announces the next job of a periodic process, which sets its period and
+ *  the absolute deadline of the job. Called by os_waitPeriod.
+ *
+ *  \param id  The periodic process
+ *  \param release  The raw system time the job is released at
+ *  \param period  The period of the process in Timer 0 overflows
+ */
+void os_releaseJob(ProcessID id, Time release, Time period) {
+    const Time relativeDeadline = schedulingInfo.relativeDeadline[id];
+    schedulingInfo.period[id] = period;
+    schedulingInfo.deadline[id] = release + (relativeDeadline ? relativeDeadline : period);
+}
+
+/*!
+ *  Announces that the current job of a periodic process completed and
+ *  counts a deadline miss if that happened too late. Called by os_waitPeriod.
+ *
+ *  \param id  The periodic process
+ *  \param now  The current raw system time
+ */
+void os_completeJob(ProcessID id, Time now) {
+    if ((int32_t)(now - schedulingInfo.deadline[id]) > 0 && schedulingInfo.deadlineMisses[id] != UINT16_MAX) {
+        schedulingInfo.deadlineMisses[id]++;
+    }
+}
+
+/*!
+ *  Collects the periodic processes out of a set of processes.
+ *
+ *  \param candidates The processes to choose from.
+ *  \return The subset of processes that have a period.
+ */
+static uint8_t periodicPids(uint8_t candidates) {
+    uint8_t periodic = 0;
+    for (uint8_t remaining = candidates; remaining; remaining &= remaining - 1) {
+        const ProcessID pid = lowestPid(remaining);
+        if (schedulingInfo.period[pid]) {
+            periodic |= 1 << pid;
+        }
+    }
+    return periodic;
 }
 
 /*!
@@ -50,20 +263,36 @@ void os_resetProcessSchedulingInformation(ProcessID id) {
  *  \return The next process to be executed determined on the basis of the even strategy.
  */
 ProcessID os_Scheduler_Even(const Process processes[], ProcessID current) {
-    return 0;
+    return nextPidAfter(os_getProcessMask(processes)->ready & ~IDLE_MASK, current);
 }
 
 /*!
  *  This function implements the random strategy. The next process is chosen based on
- *  the result of a pseudo random number generator.
+ *  the result of a pseudo random number generator. By default, this is rand(). With
+ *  OS_RANDOM_XORSHIFT, a xorshift generator is scaled to the number of candidates by a
+ *  multiplication instead of a division and the candidate is picked with a table.
  *
  *  \param processes An array holding the processes to choose the next process from.
  *  \param current The id of the current process.
  *  \return The next process to be executed determined on the basis of the random strategy.
  */
 ProcessID os_Scheduler_Random(const Process processes[], ProcessID current) {
+    uint8_t candidates = os_getProcessMask(processes)->ready & ~IDLE_MASK;
+    if (!candidates) {
+        return 0;
+    }
 
-    return 0;
+#if OS_RANDOM_XORSHIFT
+    const uint8_t draw = ((nextRandom() >> 8) * countPids(candidates)) >> 8;
+    return selectPid(candidates, draw);
+#else
+    // Skip as many candidates as drawn and take the next one
+    uint8_t skip = rand() % countPids(candidates);
+    while (skip--) {
+        candidates &= candidates - 1;
+    }
+    return lowestPid(candidates);
+#endif
 }
 
 /*!
@@ -78,8 +307,18 @@ ProcessID os_Scheduler_Random(const Process processes[], ProcessID current) {
  *  \return The next process to be executed determined on the basis of the round robin strategy.
  */
 ProcessID os_Scheduler_RoundRobin(const Process processes[], ProcessID current) {
-    // This is a presence task
-    return 0;
+    const uint8_t candidates = os_getProcessMask(processes)->ready & ~IDLE_MASK;
+
+    if (schedulingInfo.timeSlice) {
+        schedulingInfo.timeSlice--;
+    }
+    if (schedulingInfo.timeSlice && gbi(candidates, current)) {
+        return current;
+    }
+
+    const ProcessID next = nextPidAfter(candidates, current);
+    schedulingInfo.timeSlice = os_getEffectivePriority(&processes[next]);
+    return next;
 }
 
 /*!
@@ -94,8 +333,35 @@ ProcessID os_Scheduler_RoundRobin(const Process processes[], ProcessID current)
  *  \return The next process to be executed, determined based on the inactive-aging strategy.
  */
 ProcessID os_Scheduler_InactiveAging(const Process processes[], ProcessID current) {
-    // This is a presence task
-    return 0;
+    const ProcessMask *const mask = os_getProcessMask(processes);
+    const uint8_t candidates = mask->ready & ~IDLE_MASK;
+    if (!candidates) {
+        return 0;
+    }
+
+    // Age every waiting process by its priority
+    for (uint8_t waiting = candidates & ~(1 << current); waiting; waiting &= waiting - 1) {
+        const ProcessID pid = lowestPid(waiting);
+        schedulingInfo.age[pid] += os_getEffectivePriority(&processes[pid]);
+    }
+
+    // Collect the oldest processes
+    Age oldestAge = 0;
+    uint8_t oldest = 0;
+    for (uint8_t remaining = candidates; remaining; remaining &= remaining - 1) {
+        const ProcessID pid = lowestPid(remaining);
+        if (!oldest || schedulingInfo.age[pid] > oldestAge) {
+            oldestAge = schedulingInfo.age[pid];
+            oldest = 1 << pid;
+        } else if (schedulingInfo.age[pid] == oldestAge) {
+            oldest |= 1 << pid;
+        }
+    }
+
+    // Ties are broken by the highest priority, then by the lowest id
+    const ProcessID next = lowestPid(highestPriorityPids(mask, oldest));
+    schedulingInfo.age[next] = os_getEffectivePriority(&processes[next]);
+    return next;
 }
 
 /*!
@@ -108,6 +374,66 @@ ProcessID os_Scheduler_InactiveAging(const Process processes[], ProcessID curren
  *  \return The next process to be executed, determined based on the run-to-completion strategy.
  */
 ProcessID os_Scheduler_RunToCompletion(const Process processes[], ProcessID current) {
-    // This is a presence task
-    return 0;
+    const uint8_t candidates = os_getProcessMask(processes)->ready & ~IDLE_MASK;
+    if (gbi(candidates, current)) {
+        return current;
+    }
+    return nextPidAfter(candidates, current);
+}
+
+/*!
+ *  This function realizes the earliest-deadline-first strategy. Periodic
+ *  processes (see os_waitPeriod) are preferred, out of them the one whose
+ *  current job has the earliest deadline is chosen. The current process wins
+ *  ties, so equal deadlines do not cause needless switches. Processes without
+ *  a period only run if no periodic process is ready and share the processor
+ *  like in the even strategy.
+ *
+ *  \param processes An array holding the processes to choose the next process from.
+ *  \param current The id of the current process.
+ *  \return The next process to be executed, determined based on the earliest-deadline-first strategy.
+ */
+ProcessID os_Scheduler_EDF(const Process processes[], ProcessID current) {
+    const uint8_t candidates = os_getProcessMask(processes)->ready & ~IDLE_MASK;
+    const uint8_t periodic = periodicPids(candidates);
+    if (!periodic) {
+        return nextPidAfter(candidates, current);
+    }
+
+    ProcessID next = gbi(periodic, current) ? current : lowestPid(periodic);
+    for (uint8_t remaining = periodic; remaining; remaining &= remaining - 1) {
+        const ProcessID pid = lowestPid(remaining);
+        if ((int32_t)(schedulingInfo.deadline[pid] - schedulingInfo.deadline[next]) < 0) {
+            next = pid;
+        }
+    }
+    return next;
+}
+
+/*!
+ *  This function realizes the rate-monotonic strategy. Periodic processes
+ *  (see os_waitPeriod) are preferred, out of them the one with the shortest
+ *  period is chosen. The current process wins ties. Processes without a
+ *  period only run if no periodic process is ready and share the processor
+ *  like in the even strategy.
+ *
+ *  \param processes An array holding the processes to choose the next process from.
+ *  \param current The id of the current process.
+ *  \return The next process to be executed, determined based on the rate-monotonic strategy.
+ */
+ProcessID os_Scheduler_RateMonotonic(const Process processes[], ProcessID current) {
+    const uint8_t candidates = os_getProcessMask(processes)->ready & ~IDLE_MASK;
+    const uint8_t periodic = periodicPids(candidates);
+    if (!periodic) {
+        return nextPidAfter(candidates, current);
+    }
+
+    ProcessID next = gbi(periodic, current) ? current : lowestPid(periodic);
+    for (uint8_t remaining = periodic; remaining; remaining &= remaining - 1) {
+        const ProcessID pid = lowestPid(remaining);
+        if (schedulingInfo.period[pid] < schedulingInfo.period[next]) {
+            next = pid;
+        }
+    }
+    return next;
 }
@@ -15,7 +15,20 @@
 #include "os_scheduler.h"
 
 //! Structure used to store specific scheduling informations such as a time slice
-// This is a presence task
+typedef struct {
+    //! Remaining time slice of the current process (RoundRobin)
+    uint8_t timeSlice;
+    //! Age of every process (InactiveAging)
+    Age age[MAX_NUMBER_OF_PROCESSES];
+    //! Period of every process in Timer 0 overflows, 0 if it is not periodic (RateMonotonic)
+    Time period[MAX_NUMBER_OF_PROCESSES];
+    //! Deadline of every process relative to the release of its jobs, 0 if it equals the period
+    Time relativeDeadline[MAX_NUMBER_OF_PROCESSES];
+    //! Absolute deadline of the current job of every periodic process (EDF)
+    Time deadline[MAX_NUMBER_OF_PROCESSES];
+    //! Number of jobs of every process that completed after their deadline
+    uint16_t deadlineMisses[MAX_NUMBER_OF_PROCESSES];
+} SchedulingInformation;
 
 //! Used to reset the SchedulingInfo for one process
 void os_resetProcessSchedulingInformation(ProcessID id);
@@ -23,12 +36,29 @@ void os_resetProcessSchedulingInformation(ProcessID id);
 //! Used to reset the SchedulingInfo for a strategy
 void os_resetSchedulingInformation(SchedulingStrategy strategy);
 
+//! Sets the deadline of the jobs of a process relative to their release
+void os_setRelativeDeadline(ProcessID id, Time ms);
+
+//! Returns the number of jobs of a process that completed after their deadline
+uint16_t os_getDeadlineMisses(ProcessID id);
+
+//! Announces the next job of a periodic process
+void os_releaseJob(ProcessID id, Time release, Time period);
+
+//! Announces the completion of the current job of a periodic process
+void os_completeJob(ProcessID id, Time now);
+
 //! Even strategy
 ProcessID os_Scheduler_Even(const Process processes[], ProcessID current);
 
 //! Random strategy
 ProcessID os_Scheduler_Random(const Process processes[], ProcessID current);
 
+#if OS_RANDOM_XORSHIFT
+//! Seeds the generator of the random strategy
+void os_seedRandom(uint16_t seed);
+#endif
+
 //! RoundRobin strategy
 ProcessID os_Scheduler_RoundRobin(const Process processes[], ProcessID current);
 
@@ -38,4 +68,10 @@ ProcessID os_Scheduler_InactiveAging(const Process processes[], ProcessID curren
 //! RunToCompletion strategy
 ProcessID os_Scheduler_RunToCompletion(const Process processes[], ProcessID current);
 
+//! EarliestDeadlineFirst strategy
+ProcessID os_Scheduler_EDF(const Process processes[], ProcessID current);
+
+//! RateMonotonic strategy
+ProcessID os_Scheduler_RateMonotonic(const Process processes[], ProcessID current);
+
 #endif
@@ -0,0 +1,122 @@
+#include "os_semaphore.h"
+
+#include "defines.h"
+#include "os_core.h"
+#include "os_scheduler.h"
+#include "util.h"
+
+#include <avr/interrupt.h>
+
+/*! \file
+ *
+ * Counting semaphores. A process that finds no unit is blocked until
+ * os_semaphoreSignal wakes it up. The woken process takes the unit itself,
+ * so it competes with processes that arrive in the meantime.
+ * As signaling is allowed from ISRs, the semaphore is protected by disabling
+ * interrupts for a few instructions.
+ *
+ */
+
+//! The process table of the scheduler, accessed directly as os_getProcessSlot would mark the process bitmaps stale
+extern Process os_processes[MAX_NUMBER_OF_PROCESSES];
+
+/*!
+ *  Initializes a semaphore with the given number of units and no waiting processes.
+ *
+ *  \param semaphore The semaphore to initialize.
+ *  \param count The number of available units.
+ */
+void os_semaphoreInit(Semaphore *semaphore, uint8_t count) {
+    *semaphore = (Semaphore)SEMAPHORE_INITIALIZER(count);
+}
+
+/*!
+ *  Takes a unit of the semaphore. While there is none, the current process
+ *  is blocked. If the process cannot block (see os_canBlock), this busy waits
+ *  for an ISR to signal the semaphore.
+ *
+ *  \param semaphore The semaphore to take a unit from.
+ */
+void os_semaphoreWait(Semaphore *semaphore) {
+    const bool block = os_canBlock();
+    while (1) {
+        const uint8_t sreg = SREG;
+        cli();
+        if (semaphore->count) {
+            semaphore->count--;
+            os_processes[os_getCurrentProc()].blockedOn = NULL;
+            SREG = sreg;
+            return;
+        }
+        if (block) {
+            sbi(semaphore->waiting, os_getCurrentProc());
+            os_processes[os_getCurrentProc()].blockedOn = semaphore;
+            os_setProcessState(os_getCurrentProc(), OS_PS_BLOCKED);
+        }
+        SREG = sreg;
+
+        if (block) {
+            // If the scheduler preempted us right after restoring the SREG, this merely yields once more
+            os_yield();
+        } else if (!gbi(sreg, SREG_I)) {
+            os_error("Semaphore wait without interrupts");
+            return;
+        }
+    }
+}
+
+/*!
+ *  Takes a unit of the semaphore if that is possible without blocking.
+ *
+ *  \param semaphore The semaphore to take a unit from.
+ *  \return True iff a unit was taken.
+ */
+bool os_semaphoreTryWait(Semaphore *semaphore) {
+    const uint8_t sreg = SREG;
+    cli();
+    const bool taken = semaphore->count;
+    if (taken) {
+        semaphore->count--;
+    }
+    SREG = sreg;
+    return taken;
+}
+
+/*!
+ *  Returns a unit to the semaphore and wakes up the waiting process with the
+ *  highest effective priority (the lowest id on ties). Waiters that were
+ *  killed in the meantime are dropped, also if their slot was reused.
+ *
+ *  \param semaphore The semaphore to return the unit to.
+ */
+void os_semaphoreSignal(Semaphore *semaphore) {
+    const uint8_t sreg = SREG;
+    cli();
+
+    if (semaphore->count == UINT8_MAX) {
+        SREG = sreg;
+        os_error("Semaphore overflow");
+        return;
+    }
+    semaphore->count++;
+
+    ProcessID next = INVALID_PROCESS;
+    for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+        if (!gbi(semaphore->waiting, pid)) {
+            continue;
+        }
+        const Process *const process = &os_processes[pid];
+        // A killed waiter may have left its bit behind for a process that reused its slot
+        if (process->state != OS_PS_BLOCKED || process->blockedOn != semaphore) {
+            cbi(semaphore->waiting, pid);
+        } else if (next == INVALID_PROCESS || os_getEffectivePriority(process) > os_getEffectivePriority(&os_processes[next])) {
+            next = pid;
+        }
+    }
+    if (next != INVALID_PROCESS) {
+        cbi(semaphore->waiting, next);
+        os_setProcessState(next, OS_PS_READY);
+    }
+
+    SREG = sreg;
+}
@@ -0,0 +1,52 @@
+/*! \file
+ *  \brief Counting semaphores for the OS.
+ *
+ *  Contains counting semaphores whose waiting processes are blocked instead
+ *  of spinning. Signaling is possible from ISRs.
+ *
+ *  \author   Lehrstuhl Informatik 11 - RWTH Aachen
+ *  \date     2013
+ *  \version  2.0
+ */
+
+#ifndef _OS_SEMAPHORE_H
+#define _OS_SEMAPHORE_H
+
+#include "os_process.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! A counting semaphore, which has to be initialized with SEMAPHORE_INITIALIZER or os_semaphoreInit
+typedef struct {
+    //! The number of available units
+    volatile uint8_t count;
+    //! Processes blocked on the semaphore, bit n is set iff process n waits
+    volatile uint8_t waiting;
+} Semaphore;
+
+//! Static initializer of a semaphore with COUNT available units
+#define SEMAPHORE_INITIALIZER(COUNT) \
+    { .count = (COUNT), .waiting = 0 }
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Initializes a semaphore with the given number of units
+void os_semaphoreInit(Semaphore *semaphore, uint8_t count);
+
+//! Takes a unit, blocking the current process while there is none
+void os_semaphoreWait(Semaphore *semaphore);
+
+//! Takes a unit if there is one
+bool os_semaphoreTryWait(Semaphore *semaphore);
+
+//! Returns a unit and wakes up a waiting process, may be called from ISRs
+void os_semaphoreSignal(Semaphore *semaphore);
+
+#endif
@@ -36,6 +36,7 @@
 /* INTERFACE TO SPOS *****************************/
 
 #include "os_input.h"
+#include "os_pool.h"
 #include "os_process.h"
 #include "os_scheduler.h"
 #include "os_user_privileges.h"
@@ -73,12 +74,31 @@ Program *os_getProgramSlot(Program);
  * Does the OS know how to plug and play different scheduling strategies?
  * This should be implemented in exercise 2, when the scheduler is implemented.
  */
+#ifdef OS_FIXED_STRATEGY
+#define TM_COMPILE_SCHEDULING_SUPPORT 0
+#else
 #define TM_COMPILE_SCHEDULING_SUPPORT (VERSUCH >= 2)
+#endif
 /*!
  * Used to deactivate the support for the memory drivers.
  * Set this to 1 if you have implemented the memory part of SPOS.
  */
 #define TM_COMPILE_HEAP_SUPPORT (VERSUCH >= 3)
+/*!
+ * Does the OS account processor time to the scheduler and the processes?
+ * The counters are maintained by the scheduler since exercise 2.
+ */
+#define TM_COMPILE_STATISTICS_SUPPORT (VERSUCH >= 2)
+/*!
+ * Does the OS time its critical sections?
+ * This is an instrumentation mode that has to be enabled in defines.h.
+ */
+#define TM_COMPILE_CRITICAL_SUPPORT (OS_CRITICAL_STATS)
+/*!
+ * Does the OS know fixed-size block pools?
+ * Unlike the heaps, they do not depend on the memory part of SPOS.
+ */
+#define TM_COMPILE_POOL_SUPPORT (VERSUCH >= 2)
 
 /*!
  * The number of main-pages of the TM. Actually, this is set by
@@ -93,6 +113,12 @@ Program *os_getProgramSlot(Program);
  */
 #define TM_HEAP_SUPPORT 3
 
+/*!
+ * How many pools should the TM maximally support. Pools beyond this number
+ * are registered with os_pool as well, but cannot be inspected.
+ */
+#define TM_POOL_SUPPORT 4
+
 /*!
  * When dumping the map of any heap, this define specifies how many
  * map-entries should be visible at a time. Be careful when changing this
@@ -285,6 +311,7 @@ void os_taskManMain(void) {
                 lcd_line2();
                 lcd_writeString(reason16);
             }
+            lcd_flush();
             // Wait for confirmation (OK+ES)
             while (os_getInput() != (1 | (1 << 3))) continue;
             os_waitForNoInput();
@@ -372,6 +399,8 @@ void os_taskManMain(void) {
             direction += !direction;
         } while (run-- && !pageResult.success);
         direction = 0;
+        // The task manager runs as a deferred call that holds off the scheduler, so the page has to be sent to the LCD here
+        lcd_flush();
         bool newInput;
 
         // After displaying the page (or failing at it) we have to handle whether
@@ -435,7 +464,10 @@ char PROGMEM const mainLabels[] =
     "Kill Process                   \0"
     "Change Priority                \0"
     "Change Scheduling Strategy     \0"
-    "Heap(s)                        \0";
+    "Heap(s)                        \0"
+    "Statistics                     \0"
+    "Critical Sections              \0"
+    "Memory Pools                   \0";
 
 // Forward declarations for the sub-pages of the root-page.
 static tm_page tm_frontpage;
@@ -456,6 +488,18 @@ static tm_page tm_scheduling;
 static tm_page tm_heap;
 #endif
 
+#if TM_COMPILE_STATISTICS_SUPPORT
+static tm_page tm_stats;
+#endif
+
+#if TM_COMPILE_CRITICAL_SUPPORT
+static tm_page tm_critical;
+#endif
+
+#if TM_COMPILE_POOL_SUPPORT
+static tm_page tm_pool;
+#endif
+
 static tm_page tm_null;
 
 // A convenience macro to access the stack-history.
@@ -467,12 +511,14 @@ static tm_page tm_null;
 #define MAX4(Xa, X3...) (MAX2(Xa, (MAX3(X3))))
 #define MAX5(Xa, X4...) (MAX2(Xa, (MAX4(X4))))
 #define MAX6(Xa, X5...) (MAX2(Xa, (MAX5(X5))))
+#define MAX7(Xa, X6...) (MAX2(Xa, (MAX6(X6))))
+#define MAX8(Xa, X7...) (MAX2(Xa, (MAX7(X7))))
 
 #if TM_COMPILE_SCHEDULING_SUPPORT
 #if VERSUCH >= 5
-#define SS_MAX_COUNT (MAX6(OS_SS_RUN_TO_COMPLETION, OS_SS_RANDOM, OS_SS_EVEN, OS_SS_ROUND_ROBIN, OS_SS_INACTIVE_AGING, OS_SS_MULTI_LEVEL_FEEDBACK_QUEUE) + 1)
+#define SS_MAX_COUNT (MAX8(OS_SS_RUN_TO_COMPLETION, OS_SS_RANDOM, OS_SS_EVEN, OS_SS_ROUND_ROBIN, OS_SS_INACTIVE_AGING, OS_SS_EDF, OS_SS_RATE_MONOTONIC, OS_SS_MULTI_LEVEL_FEEDBACK_QUEUE) + 1)
 #else
-#define SS_MAX_COUNT (MAX5(OS_SS_RUN_TO_COMPLETION, OS_SS_RANDOM, OS_SS_EVEN, OS_SS_ROUND_ROBIN, OS_SS_INACTIVE_AGING) + 1)
+#define SS_MAX_COUNT (MAX7(OS_SS_RUN_TO_COMPLETION, OS_SS_RANDOM, OS_SS_EVEN, OS_SS_ROUND_ROBIN, OS_SS_INACTIVE_AGING, OS_SS_EDF, OS_SS_RATE_MONOTONIC) + 1)
 #endif
 
 #endif
@@ -513,6 +559,15 @@ static TM_PAGE(tm_rootpage) {
 #if TM_COMPILE_HEAP_SUPPORT
         SUBP(4, tm_heap, 0, TM_HEAP_SUPPORT)
 #endif
+#if TM_COMPILE_STATISTICS_SUPPORT
+        SUBP(5, tm_stats, 0, MAX_NUMBER_OF_PROCESSES + 1)
+#endif
+#if TM_COMPILE_CRITICAL_SUPPORT
+        SUBP(6, tm_critical, 0, (CRITICAL_HISTOGRAM_BUCKETS + 1) / 2 + 1)
+#endif
+#if TM_COMPILE_POOL_SUPPORT
+        SUBP(7, tm_pool, 0, TM_POOL_SUPPORT)
+#endif
 #undef SUBP
         default:
             result->child.call = tm_null;
@@ -719,20 +774,11 @@ MAKE_PAGEHANDLER(tm_killProc, tm_killProc_kill, 0, 1, OS_PR_KILL_SELECT, pid, pe
     return procMutator(p, PSTR("Kill"), ~uniqState(OS_PS_UNUSED));
 }
 
-extern ProcessID currentProc;
-bool internalKill(ProcessID pid) {
-    ProcessID tmp = currentProc;
-    currentProc = INVALID_PROCESS;
-    bool result = os_kill(pid);
-    currentProc = tmp;
-    return result;
-}
-
 /*!
  * The page to kill a previously selected process.
  */
 MAKE_PAGEHANDLER(tm_killProc_kill, tm_null, 0, 0, OS_PR_KILL, pid, peekStack(1).param) {
-    return procMutatorConfirm(p, PSTR("Killing"), PSTR("Cannot kill #0"), internalKill);
+    return procMutatorConfirm(p, PSTR("Killing"), PSTR("Cannot kill #0"), os_kill);
 }
 
 #endif
@@ -821,7 +867,7 @@ MAKE_PAGEHANDLER(tm_priority_changeL, tm_priority_set, 0, 1, OS_PR_PRIORITY, nul
  */
 MAKE_PAGEHANDLER(tm_priority_set, tm_null, 0, 0, OS_PR_PRIORITY, pid, peekStack(4).param) {
     lcd_writeProgString(PSTR("Setting priority"));
-    os_getProcessSlot(peekStack(4).param)->priority = ((peekStack(2).param & 0xF) << 4) + ((peekStack(1).param & 0xF));
+    os_setProcessPriority(peekStack(4).param, ((peekStack(2).param & 0xF) << 4) + ((peekStack(1).param & 0xF)));
     tm_done();
     lcd_writeProgString(PSTR(", now: "));
     lcd_writeHexByte(os_getProcessSlot(peekStack(4).param)->priority);
@@ -943,6 +989,7 @@ static bool strategyChanger(const ParamStack *p, StrategyNameLookup *names, uint
 makeStrategyNameLookup(getSchedulingStratNames, 0x18, 0,
                        // 123456789abcdef0123456789ABCDEF0
                        {OS_SS_RUN_TO_COMPLETION, PSTR("<Run To Completion>    ")}, {OS_SS_RANDOM, PSTR("<Random>               ")}, {OS_SS_EVEN, PSTR("<Even>                 ")}, {OS_SS_ROUND_ROBIN, PSTR("<Round Robin>          ")}, {OS_SS_INACTIVE_AGING, PSTR("<Inactive Aging>       ")},
+                       {OS_SS_EDF, PSTR("<Earliest Deadline>    ")}, {OS_SS_RATE_MONOTONIC, PSTR("<Rate Monotonic>       ")},
 #if VERSUCH >= 5
                        {OS_SS_MULTI_LEVEL_FEEDBACK_QUEUE, PSTR("<MLFQ>                 ")},
 #endif
@@ -1152,4 +1199,170 @@ MAKE_PAGEHANDLER(tm_heap_erase2, tm_null, 0, 0, OS_PR_ERASE_HEAP, heapId, peekSt
 
 #endif
 
+#if TM_COMPILE_STATISTICS_SUPPORT || TM_COMPILE_CRITICAL_SUPPORT || TM_COMPILE_POOL_SUPPORT
+
+/*!
+ * Prints a counter in at most four characters, using k and M as suffixes.
+ * \param count The counter to print.
+ */
+static void writeCount(uint32_t count) {
+    if (count < 10000) {
+        lcd_writeDec(count);
+    } else if (count < 1000000) {
+        lcd_writeDec(count / 1000);
+        lcd_writeChar('k');
+    } else {
+        lcd_writeDec(count / 1000000);
+        lcd_writeChar('M');
+    }
+}
+
+#endif
+
+#if TM_COMPILE_STATISTICS_SUPPORT
+
+/*!
+ * Prints the share of a time in percent of the total time.
+ * \param time The time to put in relation.
+ * \param total The time that corresponds to 100%.
+ */
+static void writePercent(uint32_t time, uint32_t total) {
+    lcd_writeDec(time / (total / 100 + 1));
+    lcd_writeChar('%');
+}
+
+/*!
+ * The total time accounted by the scheduler, i.e. the time of all processes
+ * and the scheduler itself.
+ */
+static uint32_t getTotalTime(void) {
+    uint32_t total = os_getSchedulerStats()->schedulerTime;
+    for (ProcessID pid = 0; pid < MAX_NUMBER_OF_PROCESSES; pid++) {
+        total += os_getProcessSlot(pid)->runTime;
+    }
+    return total;
+}
+
+/*!
+ * Shows the counters of the scheduler on index 0 and the counters of
+ * process #(index - 1) on the other indices. Unused slots are skipped.
+ */
+MAKE_PAGEHANDLER(tm_stats, tm_null, 0, 0, OS_PR_STATISTICS, null, 0) {
+    const uint16_t page = peekStack(0).param;
+    const SchedulerStats *const stats = os_getSchedulerStats();
+    const uint32_t total = getTotalTime();
+    if (!page) {
+        lcd_writeProgString(PSTR("ISR "));
+        writePercent(stats->schedulerTime, total);
+        lcd_writeProgString(PSTR(" CS "));
+        writePercent(stats->criticalTime, total);
+        lcd_line2();
+        lcd_writeProgString(PSTR("Switches "));
+        writeCount(stats->switchCount);
+        return true;
+    }
+    const Process *const proc = os_getProcessSlot(page - 1);
+    if (proc->state == OS_PS_UNUSED) {
+        return false;
+    }
+    lcd_writeChar('#');
+    lcd_writeDec(page - 1);
+    lcd_goto(1, 4);
+    writePercent(proc->runTime, total);
+    // Stack high-water mark and stack size
+    lcd_goto(1, 9);
+    lcd_writeChar('S');
+    writeCount(os_getStackHighWater(page - 1));
+    lcd_writeChar('/');
+    writeCount(proc->stackSize);
+    lcd_line2();
+    lcd_writeChar('R');
+    writeCount(proc->scheduleCount);
+    lcd_writeProgString(PSTR(" P"));
+    writeCount(proc->preemptCount);
+    lcd_writeProgString(PSTR(" Y"));
+    writeCount(proc->yieldCount);
+    return true;
+}
+
+#endif
+
+#if TM_COMPILE_CRITICAL_SUPPORT
+
+//! Converts os_systemTime_augment() ticks into microseconds
+#define TICKS_TO_US(TICKS) ((TICKS)*TC0_PRESCALER / (F_CPU / 1000000ul))
+
+/*!
+ * Prints one bucket of the hold time histogram on a line of its own.
+ * \param bucket The bucket to print.
+ */
+static void writeHoldBucket(uint8_t bucket) {
+    if (bucket < CRITICAL_HISTOGRAM_BUCKETS - 1) {
+        lcd_writeProgString(PSTR("< "));
+        writeCount(TICKS_TO_US(1ul << bucket));
+    } else {
+        lcd_writeProgString(PSTR(">="));
+        writeCount(TICKS_TO_US(1ul << (bucket - 1)));
+    }
+    lcd_writeProgString(PSTR("us: "));
+    writeCount(os_getCriticalStats()->histogram[bucket]);
+}
+
+/*!
+ * Shows the longest hold of the scheduler and the code that caused it on
+ * index 0, and two buckets of the hold time histogram on the other indices.
+ */
+MAKE_PAGEHANDLER(tm_critical, tm_null, 0, 0, OS_PR_CRITICAL_STATS, null, 0) {
+    const uint16_t page = peekStack(0).param;
+    const CriticalStats *const stats = os_getCriticalStats();
+    if (!page) {
+        lcd_writeProgString(PSTR("Max "));
+        writeCount(TICKS_TO_US(stats->maxHold));
+        lcd_writeProgString(PSTR("us"));
+        lcd_line2();
+        // Word address, multiply by two to find it in the disassembly
+        lcd_writeProgString(PSTR("at 0x"));
+        lcd_writeHexWord(stats->maxHoldPc);
+        return true;
+    }
+    const uint8_t bucket = 2 * (page - 1);
+    writeHoldBucket(bucket);
+    if (bucket + 1 < CRITICAL_HISTOGRAM_BUCKETS) {
+        lcd_line2();
+        writeHoldBucket(bucket + 1);
+    }
+    return true;
+}
+
+#undef TICKS_TO_US
+
+#endif
+
+#if TM_COMPILE_POOL_SUPPORT
+
+/*!
+ * Shows the occupancy of pool #index, i.e. the allocated, the highest
+ * number of simultaneously allocated and the total number of blocks.
+ * Unregistered pools are skipped.
+ */
+MAKE_PAGEHANDLER(tm_pool, tm_null, 0, 0, OS_PR_SHOW_POOL, null, 0) {
+    const Pool *const pool = os_lookupPool(peekStack(0).param);
+    if (!pool) {
+        return false;
+    }
+    lcd_writeProgString(pool->name);
+    lcd_goto(1, 12);
+    writeCount(pool->blockSize);
+    lcd_writeChar('B');
+    lcd_line2();
+    writeCount(pool->used);
+    lcd_writeChar('/');
+    writeCount(pool->blockCount);
+    lcd_writeProgString(PSTR(" Peak "));
+    writeCount(pool->peak);
+    return true;
+}
+
+#endif
+
 #pragma GCC pop_options
@@ -0,0 +1,161 @@
+#include "os_timer.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+/*! \file
+ *
+ * Software timers on a hashed timer wheel. A timer is kept in the slot its
+ * expiry hashes to, so each Timer 0 overflow only walks the timers of one
+ * slot instead of all of them. Timers that expire more than
+ * TIMER_WHEEL_SLOTS overflows in the future share the slot and are skipped
+ * until their round comes.
+ * Callbacks run inside the Timer 0 overflow ISR with interrupts disabled.
+ * They therefore have to be short and may only use ISR-safe functions such as
+ * os_signalEvent, os_semaphoreSignal or os_queue_send. They may also start
+ * and stop timers, including their own one.
+ *
+ */
+
+#if TIMER_WHEEL_SLOTS & (TIMER_WHEEL_SLOTS - 1)
+#error "TIMER_WHEEL_SLOTS has to be a power of two"
+#endif
+
+//! The slots of the wheel, each one is a singly linked list
+static Timer *os_timerWheel[TIMER_WHEEL_SLOTS];
+
+//! Number of timers in the wheel, the tick returns immediately if there are none
+static volatile uint8_t os_activeTimers;
+
+//! The last raw system time the wheel was advanced to
+static Time os_timerNow;
+
+/*!
+ *  Puts a timer into the slot of its expiry. Must be called with interrupts disabled.
+ *
+ *  \param timer The timer to insert.
+ */
+static void os_timerInsert(Timer *timer) {
+    Timer **const slot = &os_timerWheel[timer->expiry & (TIMER_WHEEL_SLOTS - 1)];
+    timer->next = *slot;
+    *slot = timer;
+}
+
+/*!
+ *  Removes a timer from its slot. Must be called with interrupts disabled.
+ *
+ *  \param timer The timer to remove, which has to be in the wheel.
+ */
+static void os_timerRemove(Timer *timer) {
+    Timer **link = &os_timerWheel[timer->expiry & (TIMER_WHEEL_SLOTS - 1)];
+    while (*link != timer) {
+        link = &(*link)->next;
+    }
+    *link = timer->next;
+}
+
+/*!
+ *  Initializes a timer such that it is stopped. Must not be called while the
+ *  timer runs, as it would stay in the wheel.
+ *
+ *  \param timer The timer to initialize.
+ */
+void os_timerInit(Timer *timer) {
+    *timer = (Timer)TIMER_INITIALIZER;
+}
+
+/*!
+ *  Starts (or restarts) a timer. The callback is called once the delay has
+ *  passed and, if a period is given, again after every period. Periodic
+ *  timers are rescheduled relative to their last expiry, so they do not drift.
+ *  Times are rounded up to Timer 0 overflows of approx. 3.3 ms.
+ *
+ *  \param timer The timer, initialized with TIMER_INITIALIZER or os_timerInit, whose memory has to stay valid while it runs.
+ *  \param delayMs The time until the first expiry in ms.
+ *  \param periodMs The time between two expiries in ms, 0 for a one-shot timer.
+ *  \param callback The function to call on every expiry.
+ *  \param arg The argument to pass to the callback.
+ */
+void os_timerStart(Timer *timer, Time delayMs, Time periodMs, TimerCallback *callback, void *arg) {
+    Time delay = os_systemTime_msToRaw(delayMs);
+    if (!delay) {
+        delay = 1;
+    }
+
+    const uint8_t sreg = SREG;
+    cli();
+    if (timer->active) {
+        os_timerRemove(timer);
+    } else {
+        os_activeTimers++;
+    }
+    timer->expiry = os_systemTime_raw() + delay;
+    timer->period = os_systemTime_msToRaw(periodMs);
+    timer->callback = callback;
+    timer->arg = arg;
+    timer->active = true;
+    os_timerInsert(timer);
+    SREG = sreg;
+}
+
+/*!
+ *  Stops a timer, its callback is not called anymore.
+ *
+ *  \param timer The timer to stop.
+ *  \return True iff the timer was running.
+ */
+bool os_timerStop(Timer *timer) {
+    const uint8_t sreg = SREG;
+    cli();
+    const bool wasActive = timer->active;
+    if (wasActive) {
+        os_timerRemove(timer);
+        timer->active = false;
+        os_activeTimers--;
+    }
+    SREG = sreg;
+    return wasActive;
+}
+
+/*!
+ *  Advances the wheel to the current raw system time and calls the callbacks
+ *  of all timers that expired. Overflows that were missed while interrupts
+ *  were disabled are caught up.
+ */
+void os_timerTick(void) {
+    const Time now = os_systemTime_raw();
+    // Nothing to catch up without timers or after os_systemTime_reset()
+    if (!os_activeTimers || (int32_t)(now - os_timerNow) < 0) {
+        os_timerNow = now;
+        return;
+    }
+
+    while (os_timerNow != now) {
+        const Time tick = ++os_timerNow;
+
+        Timer **const slot = &os_timerWheel[tick & (TIMER_WHEEL_SLOTS - 1)];
+        while (1) {
+            // Callbacks may start or stop timers of this slot, so the slot is searched from its start for every expiry
+            Timer **link = slot;
+            while (*link && (int32_t)((*link)->expiry - tick) > 0) {
+                link = &(*link)->next;
+            }
+            Timer *const timer = *link;
+            if (!timer) {
+                break;
+            }
+
+            // The timer is rescheduled or stopped before its callback runs, so the wheel is
+            // consistent for the callback. A rescheduled timer is due after this tick, so it is not found again.
+            *link = timer->next;
+            if (timer->period) {
+                timer->expiry += timer->period;
+                os_timerInsert(timer);
+            } else {
+                timer->active = false;
+                os_activeTimers--;
+            }
+            timer->callback(timer->arg);
+        }
+    }
+}
@@ -0,0 +1,75 @@
+/*! \file
+ *  \brief Software timers for the OS.
+ *
+ *  Contains one-shot and periodic timers whose callbacks run on the Timer 0
+ *  tick, so many small periodic jobs need neither a process nor a stack.
+ *
+ *  \author   Lehrstuhl Informatik 11 - RWTH Aachen
+ *  \date     2013
+ *  \version  2.0
+ */
+
+#ifndef _OS_TIMER_H
+#define _OS_TIMER_H
+
+#include "util.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//----------------------------------------------------------------------------
+// Constants
+//----------------------------------------------------------------------------
+
+//! Number of slots of the timer wheel, has to be a power of two
+#define TIMER_WHEEL_SLOTS 8
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+//! The type of a timer callback, it receives the argument given to os_timerStart
+typedef void TimerCallback(void *arg);
+
+/*!
+ *  A software timer, which has to be initialized with TIMER_INITIALIZER or
+ *  os_timerInit before it is started for the first time. The memory is owned
+ *  by the caller and must stay valid while the timer runs.
+ */
+typedef struct Timer {
+    //! The next timer in the same slot of the wheel
+    struct Timer *next;
+    //! Raw system time of the next expiry, see os_systemTime_raw()
+    Time expiry;
+    //! Period in Timer 0 overflows, 0 for a one-shot timer
+    Time period;
+    //! The function to call on expiry
+    TimerCallback *callback;
+    //! The argument of the callback
+    void *arg;
+    //! Whether the timer is in the wheel
+    bool active;
+} Timer;
+
+//! Static initializer of a stopped timer
+#define TIMER_INITIALIZER \
+    { .next = NULL, .active = false }
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Initializes a stopped timer
+void os_timerInit(Timer *timer);
+
+//! Starts a one-shot (periodMs == 0) or periodic timer
+void os_timerStart(Timer *timer, Time delayMs, Time periodMs, TimerCallback *callback, void *arg);
+
+//! Stops a timer
+bool os_timerStop(Timer *timer);
+
+//! Advances the timer wheel, called by the Timer 0 overflow ISR
+void os_timerTick(void);
+
+#endif
@@ -0,0 +1,133 @@
+#include "os_trace.h"
+
+#include "defines.h"
+#include "util.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <stdbool.h>
+
+/*! \file
+ *
+ * Binary kernel trace. Records are appended to a ring buffer with
+ * interrupts disabled for a few instructions, so the kernel may trace from
+ * ISRs and critical sections alike. The buffer is sent by the USART0 data
+ * register empty interrupt, which the idle process enables whenever records
+ * are pending. If the buffer is full, records are dropped and counted, so
+ * tracing never delays the kernel.
+ *
+ */
+
+#if OS_TRACE
+
+#if !OS_TICKS
+#error "The trace takes its timestamps from os_ticks(), see OS_TICKS"
+#endif
+
+#if TRACE_BUFFER_SIZE > 256 || (TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) || TRACE_BUFFER_SIZE < 8
+#error "TRACE_BUFFER_SIZE must be a power of two between 8 and 256"
+#endif
+
+//! Mask that wraps an index into the trace buffer
+#define TRACE_MASK (TRACE_BUFFER_SIZE - 1)
+
+//! Records waiting to be sent
+static uint8_t os_traceBuffer[TRACE_BUFFER_SIZE];
+
+//! Index of the next byte to write, always the start of a record
+static volatile uint8_t os_traceHead = 0;
+
+//! Index of the next byte to send
+static volatile uint8_t os_traceTail = 0;
+
+//! Upper 16 bits of the time of the last TRACE_TIME record
+static uint16_t os_traceEpoch = 0;
+
+//! Number of records dropped since the last TRACE_OVERRUN record
+static uint8_t os_traceDropped = 0;
+
+/*!
+ * Sets up USART0 for sending 8N1 at TRACE_BAUD. Only the transmitter is enabled.
+ */
+void os_traceInit(void) {
+    // Double speed gives a smaller baud rate error at 20 MHz
+    UBRR0 = (F_CPU + 4 * TRACE_BAUD) / (8 * TRACE_BAUD) - 1;
+    UCSR0A = (1 << U2X0);
+    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+    UCSR0B = (1 << TXEN0);
+}
+
+/*!
+ * Writes a record to the buffer. Must be called with interrupts disabled.
+ *
+ * \param time The time field of the record.
+ * \param typePid The type in the upper and the process in the lower nibble.
+ * \param arg The argument of the record.
+ * \return False if the buffer was full.
+ */
+static bool os_tracePut(uint16_t time, uint8_t typePid, uint8_t arg) {
+    const uint8_t head = os_traceHead;
+    if (((os_traceTail - head - 1) & TRACE_MASK) < 4) {
+        return false;
+    }
+    // The buffer holds a whole number of records, so a record never wraps
+    os_traceBuffer[head] = time;
+    os_traceBuffer[head + 1] = time >> 8;
+    os_traceBuffer[head + 2] = typePid;
+    os_traceBuffer[head + 3] = arg;
+    os_traceHead = (head + 4) & TRACE_MASK;
+    return true;
+}
+
+/*!
+ * Appends a record to the trace buffer. A TRACE_TIME record precedes it if
+ * the upper bits of the time changed, and a TRACE_OVERRUN record if records
+ * were dropped before.
+ *
+ * \param type The type of the event.
+ * \param pid The process the event refers to.
+ * \param arg The argument of the event, see TraceEvent.
+ */
+void os_traceRecord(TraceEvent type, ProcessID pid, uint8_t arg) {
+    const uint8_t sreg = SREG;
+    cli();
+
+    const Ticks time = os_ticks() >> TRACE_TIME_SHIFT;
+    const uint16_t epoch = time >> 16;
+    const bool stored = (epoch == os_traceEpoch || os_tracePut(epoch, TRACE_TIME << 4, 0)) &&
+                        (!os_traceDropped || os_tracePut(time, TRACE_OVERRUN << 4, os_traceDropped)) &&
+                        os_tracePut(time, (type << 4) | (pid & 0x0F), arg);
+    if (stored) {
+        os_traceEpoch = epoch;
+        os_traceDropped = 0;
+    } else if (os_traceDropped != UINT8_MAX) {
+        os_traceDropped++;
+    }
+
+    SREG = sreg;
+}
+
+/*!
+ * Starts sending the buffer if records are pending. The data register
+ * empty interrupt keeps sending until the buffer is empty.
+ */
+void os_traceFlush(void) {
+    if (os_traceHead != os_traceTail) {
+        sbi(UCSR0B, UDRIE0);
+    }
+}
+
+/*!
+ * Sends the next byte of the trace buffer and turns itself off once the buffer is empty.
+ */
+ISR(USART0_UDRE_vect) {
+    const uint8_t tail = os_traceTail;
+    if (tail == os_traceHead) {
+        cbi(UCSR0B, UDRIE0);
+        return;
+    }
+    UDR0 = os_traceBuffer[tail];
+    os_traceTail = (tail + 1) & TRACE_MASK;
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*! \file
+ *  \brief Binary kernel trace for the OS.
+ *
+ *  Contains a ring buffer of 4 byte records that the kernel fills with
+ *  context switches, process creation and termination, critical sections
+ *  and blocking. The idle process streams the buffer over USART0, where
+ *  tools/trace_decode.py turns it into a timeline.
+ *
+ *  \author   Lehrstuhl Informatik 11 - RWTH Aachen
+ *  \date     2013
+ *  \version  2.0
+ */
+
+#ifndef _OS_TRACE_H
+#define _OS_TRACE_H
+
+#include "defines.h"
+#include "os_process.h"
+
+#include <stdint.h>
+
+//----------------------------------------------------------------------------
+// Types
+//----------------------------------------------------------------------------
+
+/*!
+ *  Type of a trace record. A record consists of the time in units of
+ *  2^TRACE_TIME_SHIFT cycles (16 bit, little endian), the type in the upper
+ *  and the process id in the lower nibble of the third byte, and an argument.
+ */
+typedef enum {
+    //! Upper 16 bits of the time of the following records in place of the time, argument unused
+    TRACE_TIME,
+    //! Records were dropped because the buffer was full, the argument is their number (saturated)
+    TRACE_OVERRUN,
+    //! The process switched to the process in the argument
+    TRACE_SWITCH,
+    //! The process was started, the argument is its priority
+    TRACE_EXEC,
+    //! The process was terminated, the argument is the process that terminated it
+    TRACE_KILL,
+    //! The process entered the outermost critical section
+    TRACE_CRITICAL_ENTER,
+    //! The process left the outermost critical section
+    TRACE_CRITICAL_LEAVE,
+    //! The process was blocked
+    TRACE_BLOCK,
+    //! The process became ready again after it was blocked
+    TRACE_UNBLOCK
+} TraceEvent;
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+#if OS_TRACE
+//! Sets up USART0 for streaming the trace
+void os_traceInit(void);
+
+//! Appends a record to the trace buffer, may be called from ISRs
+void os_traceRecord(TraceEvent type, ProcessID pid, uint8_t arg);
+
+//! Starts streaming the trace buffer if it is not empty
+void os_traceFlush(void);
+
+//! Records an event if tracing is enabled, otherwise this compiles to nothing
+#define os_trace(TYPE, PID, ARG) os_traceRecord((TYPE), (PID), (ARG))
+#else
+#define os_trace(TYPE, PID, ARG) \
+    do {                         \
+    } while (0)
+#endif
+
+#endif
@@ -0,0 +1,213 @@
+#include "os_uart.h"
+
+#include "defines.h"
+#include "os_core.h"
+#include "os_scheduler.h"
+#include "util.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+/*! \file
+ *
+ * Interrupt driven USART0 driver. Bytes to send are queued in a ring buffer
+ * that the data register empty interrupt drains, received bytes are queued
+ * by the receive complete interrupt. Both buffers are only touched with
+ * interrupts disabled for a few instructions, so the driver may be used from
+ * ISRs and critical sections. If the transmit buffer is full while interrupts
+ * are disabled, the transmitter is fed directly, so no output is lost.
+ *
+ */
+
+#if OS_UART
+
+#if OS_TRACE
+#error "The trace and the UART stdio both need USART0, enable only one of OS_TRACE and OS_UART"
+#endif
+
+#if (UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1)) || UART_TX_BUFFER_SIZE > 256 || (UART_RX_BUFFER_SIZE & (UART_RX_BUFFER_SIZE - 1)) || UART_RX_BUFFER_SIZE > 256
+#error "UART_TX_BUFFER_SIZE and UART_RX_BUFFER_SIZE must be powers of two of at most 256"
+#endif
+
+//! Bytes waiting to be sent
+static uint8_t os_uartTx[UART_TX_BUFFER_SIZE];
+
+//! Index of the next byte to queue for sending
+static volatile uint8_t os_uartTxHead = 0;
+
+//! Index of the next byte to send
+static volatile uint8_t os_uartTxTail = 0;
+
+//! Bytes received but not read yet
+static uint8_t os_uartRx[UART_RX_BUFFER_SIZE];
+
+//! Index of the next received byte to store
+static volatile uint8_t os_uartRxHead = 0;
+
+//! Index of the next received byte to read
+static volatile uint8_t os_uartRxTail = 0;
+
+//! Received bytes that were dropped, see os_uartGetRxOverruns
+static volatile uint16_t os_uartRxOverruns = 0;
+
+static int os_uartPutWrapper(const char c, FILE *stream) {
+    if (c == '\n') {
+        os_uartPutChar('\r');
+    }
+    os_uartPutChar(c);
+    return 0;
+}
+
+static int os_uartGetWrapper(FILE *stream) {
+    return os_uartGetChar();
+}
+
+FILE *uartout = &(FILE)FDEV_SETUP_STREAM(os_uartPutWrapper, os_uartGetWrapper, _FDEV_SETUP_RW);
+
+/*!
+ * Sets up USART0 for 8N1 at UART_BAUD and enables the receive interrupt.
+ */
+void os_uartInit(void) {
+    // Double speed gives a smaller baud rate error at 20 MHz
+    UBRR0 = (F_CPU + 4 * UART_BAUD) / (8 * UART_BAUD) - 1;
+    UCSR0A = (1 << U2X0);
+    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+    UCSR0B = (1 << RXCIE0) | (1 << RXEN0) | (1 << TXEN0);
+}
+
+/*!
+ * Hands the oldest queued byte to the transmitter. Must be called with
+ * interrupts disabled, the transmit buffer not empty and the data register empty.
+ */
+static void os_uartSendQueued(void) {
+    const uint8_t tail = os_uartTxTail;
+    UDR0 = os_uartTx[tail];
+    os_uartTxTail = (tail + 1) & (UART_TX_BUFFER_SIZE - 1);
+}
+
+/*!
+ * Queues a byte for transmission. If the transmit buffer is full, this
+ * waits for the interrupt to make room, or makes room itself if interrupts
+ * are disabled.
+ *
+ * \param byte The byte to send.
+ */
+void os_uartPutChar(uint8_t byte) {
+    while (1) {
+        const uint8_t sreg = SREG;
+        cli();
+        const uint8_t head = os_uartTxHead;
+        const uint8_t next = (head + 1) & (UART_TX_BUFFER_SIZE - 1);
+        if (next != os_uartTxTail) {
+            os_uartTx[head] = byte;
+            os_uartTxHead = next;
+            sbi(UCSR0B, UDRIE0);
+            SREG = sreg;
+            return;
+        }
+        if (!gbi(sreg, SREG_I)) {
+            // The interrupt cannot run, so wait for the transmitter here
+            while (!gbi(UCSR0A, UDRE0)) {
+            }
+            os_uartSendQueued();
+        }
+        SREG = sreg;
+    }
+}
+
+/*!
+ * Queues a string from program memory for transmission, without newline translation.
+ *
+ * \param string The string to send.
+ */
+void os_uartWriteProgString(const char *string) {
+    char c;
+    while ((c = pgm_read_byte(string++))) {
+        os_uartPutChar(c);
+    }
+}
+
+/*!
+ * Returns how many received bytes can be read without waiting.
+ *
+ * \return The number of bytes in the receive buffer.
+ */
+uint8_t os_uartAvailable(void) {
+    return (os_uartRxHead - os_uartRxTail) & (UART_RX_BUFFER_SIZE - 1);
+}
+
+/*!
+ * Returns the next received byte. While the receive buffer is empty, the
+ * processor is handed to other processes if possible, see os_canBlock.
+ *
+ * \return The received byte.
+ */
+uint8_t os_uartGetChar(void) {
+    while (os_uartRxHead == os_uartRxTail) {
+        if (os_canBlock()) {
+            os_yield();
+        } else if (!gbi(SREG, SREG_I)) {
+            os_error("UART read without interrupts");
+            return 0;
+        }
+    }
+    const uint8_t tail = os_uartRxTail;
+    const uint8_t byte = os_uartRx[tail];
+    os_uartRxTail = (tail + 1) & (UART_RX_BUFFER_SIZE - 1);
+    return byte;
+}
+
+/*!
+ * Returns how many received bytes had to be dropped because the receive buffer was full.
+ *
+ * \return The number of dropped bytes.
+ */
+uint16_t os_uartGetRxOverruns(void) {
+    uint16_t overruns;
+    const uint8_t sreg = SREG;
+    cli();
+    overruns = os_uartRxOverruns;
+    SREG = sreg;
+    return overruns;
+}
+
+/*!
+ * Waits until the transmit buffer is empty, e.g. before a reset.
+ */
+void os_uartFlush(void) {
+    while (os_uartTxHead != os_uartTxTail) {
+        if (!gbi(SREG, SREG_I) && gbi(UCSR0A, UDRE0)) {
+            // The interrupt cannot run, so feed the transmitter here
+            os_uartSendQueued();
+        }
+    }
+}
+
+/*!
+ * Sends the next queued byte and turns itself off once the buffer is empty.
+ */
+ISR(USART0_UDRE_vect) {
+    if (os_uartTxHead == os_uartTxTail) {
+        cbi(UCSR0B, UDRIE0);
+        return;
+    }
+    os_uartSendQueued();
+}
+
+/*!
+ * Stores a received byte, or drops it if the receive buffer is full.
+ */
+ISR(USART0_RX_vect) {
+    const uint8_t byte = UDR0;
+    const uint8_t head = os_uartRxHead;
+    const uint8_t next = (head + 1) & (UART_RX_BUFFER_SIZE - 1);
+    if (next == os_uartRxTail) {
+        os_uartRxOverruns++;
+        return;
+    }
+    os_uartRx[head] = byte;
+    os_uartRxHead = next;
+}
+
+#endif
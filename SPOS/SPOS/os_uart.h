@@ -0,0 +1,57 @@
+/*! \file
+ *  \brief Interrupt driven serial stdio for the OS.
+ *
+ *  Contains a driver for USART0 with ring buffers in both directions and a
+ *  stdio stream on top of it. Writing only copies into the buffer, the
+ *  transmission is done by interrupts in the background.
+ *
+ *  \author   Lehrstuhl Informatik 11 - RWTH Aachen
+ *  \date     2013
+ *  \version  2.0
+ */
+
+#ifndef _OS_UART_H
+#define _OS_UART_H
+
+#include "defines.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#if OS_UART
+
+//----------------------------------------------------------------------------
+// Globals
+//----------------------------------------------------------------------------
+
+//! Stream that reads from and writes to USART0, '\n' is sent as "\r\n"
+extern FILE *uartout;
+
+//----------------------------------------------------------------------------
+// Function headers
+//----------------------------------------------------------------------------
+
+//! Sets up USART0 and enables the transmitter and the receiver
+void os_uartInit(void);
+
+//! Queues a byte for transmission, waits only if the transmit buffer is full
+void os_uartPutChar(uint8_t byte);
+
+//! Queues a string from program memory for transmission
+void os_uartWriteProgString(const char *string);
+
+//! Returns the number of received bytes that were not read yet
+uint8_t os_uartAvailable(void);
+
+//! Returns the next received byte, waits until there is one
+uint8_t os_uartGetChar(void);
+
+//! Returns the number of received bytes that were dropped because the receive buffer was full
+uint16_t os_uartGetRxOverruns(void);
+
+//! Waits until every queued byte was handed to the transmitter
+void os_uartFlush(void);
+
+#endif
+
+#endif
@@ -53,7 +53,10 @@ typedef enum {
     OS_PR_ALLOCATION_SELECT, //!< Request to show the allocation strategy selection for the previously selected heap.
     OS_PR_ALLOCATION,        //!< Request to set the allocation strategy of the selected heap to the newly chosen.
     OS_PR_SHOW_HEAP,         //!< Request to open the heap sub menu for the selected heap.
-    OS_PR_ERASE_HEAP         //!< Request to completely erase the contents (map and use) of the selected heap.
+    OS_PR_ERASE_HEAP,        //!< Request to completely erase the contents (map and use) of the selected heap.
+    OS_PR_STATISTICS,        //!< Request to show the CPU usage statistics of the scheduler and the processes.
+    OS_PR_CRITICAL_STATS,    //!< Request to show how long critical sections held off the scheduler.
+    OS_PR_SHOW_POOL          //!< Request to show the occupancy of the selected block pool.
 } PermissionRequest;
 
 //! The argument of the request.
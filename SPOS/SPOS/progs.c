@@ -9,7 +9,7 @@ REGISTER_AUTOSTART(autostart_a);
 void autostart_a(void) {
     while (1) {
         lcd_writeChar('A');
-        delayMs(DEFAULT_OUTPUT_DELAY);
+        os_sleep(DEFAULT_OUTPUT_DELAY);
     }
 }
 
@@ -17,7 +17,7 @@ REGISTER_AUTOSTART(autostart_b);
 void autostart_b(void) {
     while (1) {
         lcd_writeChar('B');
-        delayMs(DEFAULT_OUTPUT_DELAY);
+        os_sleep(DEFAULT_OUTPUT_DELAY);
     }
 }
 
@@ -25,7 +25,7 @@ REGISTER_AUTOSTART(autostart_c);
 void autostart_c(void) {
     while (1) {
         lcd_writeChar('C');
-        delayMs(DEFAULT_OUTPUT_DELAY);
+        os_sleep(DEFAULT_OUTPUT_DELAY);
     }
 }
 
@@ -33,6 +33,6 @@ REGISTER_AUTOSTART(autostart_d);
 void autostart_d(void) {
     while (1) {
         lcd_writeChar('D');
-        delayMs(DEFAULT_OUTPUT_DELAY);
+        os_sleep(DEFAULT_OUTPUT_DELAY);
     }
 }
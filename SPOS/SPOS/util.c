@@ -5,9 +5,11 @@
 #include "lcd.h"
 #include "os_core.h"
 #include "os_input.h"
+#include "os_timer.h"
 
 #include <avr/interrupt.h>
 #include <avr/io.h>
+#include <util/atomic.h>
 
 /*! \file
  *
@@ -22,9 +24,12 @@ static Time os_systemTime_overflows = 0;
 
 /*!
  * ISR that counts the number of occurred Timer 0 overflows for the os_systemTime_[coarse|precise] functions.
+ * It also drives the debouncing of the buttons and the software timers.
  */
 ISR(TIMER0_OVF_vect) {
     os_systemTime_overflows++;
+    os_debounceInput();
+    os_timerTick();
 }
 
 /*!
@@ -53,7 +58,7 @@ Time os_systemTime_coarse(void) {
  *
  * \return os_systemTime_overflows scaled by cpu speed , timer prescaler as well as register size
  */
-static Time os_systemTime_augment(void) {
+Time os_systemTime_augment(void) {
     /*! in case Interrupts are off and the overflow flag is activated we simulate the overflow interrupt.
      *  The flag signalizes, that an overflow occurred. This would have been handled by the ISR immediately
      *  but since the interrupts are off, the controller will wait until they come back on. However,
@@ -89,40 +94,139 @@ Time os_systemTime_precise(void) {
 }
 
 
+/*!
+ * Function that returns the current systemtime as the plain number of Timer 0 overflows.
+ * Unlike os_systemTime_coarse() no division is needed, so this is cheap enough for
+ * the scheduler to compare wake-up deadlines on every tick.
+ *
+ * \return The number of Timer 0 overflows since the last reset
+ */
+Time os_systemTime_raw(void) {
+    // Account for an overflow that could not be handled yet, see os_systemTime_augment()
+    if ((!(SREG & (1 << 7))) && (TIFR0 & (1 << TOV0))) {
+        TIFR0 |= (1 << TOV0);
+        os_systemTime_overflows++;
+    }
+    return os_systemTime_overflows;
+}
+
+/*!
+ * Converts a duration into the unit of os_systemTime_raw().
+ * One overflow takes TC0_PRESCALER * 256 cycles, so this is a multiplication with the
+ * cycles per ms followed by shifts. The duration is split to avoid a 32 bit overflow.
+ *
+ * \param ms The duration in ms
+ * \return The number of Timer 0 overflows that cover at least the given duration
+ */
+Time os_systemTime_msToRaw(Time ms) {
+    const Time cyclesPerMs = F_CPU / 1000ul;
+    const Time cyclesPerOverflow = TC0_PRESCALER * 256ul;
+    return (ms / cyclesPerOverflow) * cyclesPerMs + ((ms % cyclesPerOverflow) * cyclesPerMs + cyclesPerOverflow - 1) / cyclesPerOverflow;
+}
+
 /*!
  *  Function that may be used to wait for specific time intervals.
- *  Therefore, we calculate the relative time to wait. This value is added to the current system time
- *  in order to get the destination time. Then, we wait until a temporary variable reaches this value.
+ *  Therefore, we convert the time to wait into Timer 0 counts once and then poll
+ *  os_systemTime_augment() until that many counts have passed, so the loop itself
+ *  needs no division. The unsigned difference stays correct when the system time wraps.
+ *  This busy waits and therefore works without the scheduler (e.g. during initialization or inside
+ *  critical sections). Processes that may give up the processor in the meantime should use os_sleep().
  *
  *  \param ms  The time to be waited in milliseconds (max. 2^32 = 4294967296 ms ~= 7 weeks)
  */
 void delayMs(Time ms) {
-    Time startTime = os_systemTime_precise();
-    Time destinationTime = startTime + ms;
-    Time now;
-
-    /*! We have to distinguish two cases:
-     * 1.) If the startTime is smaller than the destinationTime, we can wait until the current time (= now)
-     * is bigger than startTime but smaller than the destinationTime.
-     * Keep waiting if the value of now is anywhere in the sections marked with +
-     *    0 |----------------S+++++++++++++++D-------| max time
-
-     * 2.) If we detect an overflow (startTime > destinationTime) then we have to wait for now reaching
-     * maxtime (the overflow) and afterwards now reaching destinationTime
-     * Keep waiting if now is anywhere in the sections marked with +
-     *    0 |++++++++++++++++D---------------S+++++++| max time
-     */
-    if (startTime <= destinationTime) {
-        do {
-            now = os_systemTime_precise();
-        } while ((startTime <= now) && (now < destinationTime));
-    } else {
-        do {
-            now = os_systemTime_precise();
-        } while ((now < destinationTime) || (startTime <= now));
+    // An hour of Timer 0 counts still fits into 32 bits, so longer delays are waited for piecewise
+    const Time chunk = TIME_H_TO_MS(1);
+    while (ms > chunk) {
+        delayMs(chunk);
+        ms -= chunk;
+    }
+
+    // As in os_systemTime_msToRaw(), the duration is split to avoid a 32 bit overflow
+    const Time cyclesPerMs = F_CPU / 1000ul;
+    const Time counts = (ms / TC0_PRESCALER) * cyclesPerMs + ((ms % TC0_PRESCALER) * cyclesPerMs + TC0_PRESCALER - 1) / TC0_PRESCALER;
+
+    const Time startTime = os_systemTime_augment();
+    while (os_systemTime_augment() - startTime < counts) {
+    }
+}
+
+#if OS_TICKS
+//! Upper half of os_ticks(), counted by the Timer 1 overflow
+static volatile uint16_t os_ticks_overflows = 0;
+
+/*!
+ * ISR that counts the overflows of Timer 1 for os_ticks()
+ */
+ISR(TIMER1_OVF_vect) {
+    os_ticks_overflows++;
+}
+
+/*!
+ * Starts Timer 1 in normal mode without prescaler, so it counts every CPU cycle
+ */
+void os_ticks_init(void) {
+    TCCR1A = 0;
+    TCCR1C = 0;
+    TCNT1 = 0;
+    os_ticks_overflows = 0;
+    TIFR1 = (1 << TOV1);
+    sbi(TIMSK1, TOIE1);
+    TCCR1B = (1 << CS10);
+}
+
+/*!
+ * Returns a monotonic timestamp in CPU cycles. Only shifts and ORs are needed,
+ * so this is cheap enough for hot loops and instrumentation. Durations are the
+ * unsigned difference of two timestamps, which is correct across one wrap.
+ *
+ * \return The number of CPU cycles since os_ticks_init(), modulo 2^32
+ */
+Ticks os_ticks(void) {
+    uint16_t high;
+    uint16_t low;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        high = os_ticks_overflows;
+        low = TCNT1;
+        // An overflow that was not handled yet belongs to this reading only if the counter already restarted
+        if ((TIFR1 & (1 << TOV1)) && !(low & 0x8000)) {
+            high++;
+        }
     }
+    return ((Ticks)high << 16) | low;
+}
+
+/*!
+ * Converts a number of ticks into microseconds
+ *
+ * \param ticks The duration in ticks
+ * \return The duration in microseconds, rounded down
+ */
+uint32_t os_ticksToUs(Ticks ticks) {
+    return ticks / (F_CPU / 1000000ul);
 }
 
+/*!
+ * Converts a number of ticks into milliseconds
+ *
+ * \param ticks The duration in ticks
+ * \return The duration in milliseconds, rounded down
+ */
+Time os_ticksToMs(Ticks ticks) {
+    return ticks / TICKS_PER_MS;
+}
+
+/*!
+ * Converts milliseconds into ticks, which only takes a multiplication
+ *
+ * \param ms The duration in milliseconds
+ * \return The duration in ticks
+ */
+Ticks os_msToTicks(Time ms) {
+    return ms * TICKS_PER_MS;
+}
+#endif
+
 /*!
  *  Simple assertion function that is used to ensure specific behavior
  *  Note that there is a define assert(exp,errormsg) that simplifies the usage of this function.
@@ -139,3 +243,85 @@ bool assertPstr(bool exp, const char *errormsg) {
 
     return 1;
 }
+
+#if OS_CRITICAL_STATS
+//! Hold times recorded so far, see os_getCriticalStats
+static CriticalStats os_criticalStats;
+
+//! Start of the outermost ATOMIC block
+static Time os_atomicStart;
+
+//! Code address that started the outermost ATOMIC block
+static uint16_t os_atomicPc;
+
+/*!
+ * Books a hold of the scheduler that ends now. Must be called with interrupts disabled.
+ *
+ * \param start The system time the hold started at, see os_systemTime_augment.
+ * \param pc The word address of the code that started the hold.
+ */
+void os_recordCriticalHold(Time start, uint16_t pc) {
+    const Time hold = os_systemTime_augment() - start;
+
+    if (hold > os_criticalStats.maxHold) {
+        os_criticalStats.maxHold = hold;
+        os_criticalStats.maxHoldPc = pc;
+    }
+
+    // The bucket is the number of significant bits of the hold time
+    uint8_t bucket = 0;
+    for (Time rest = hold; rest && bucket < CRITICAL_HISTOGRAM_BUCKETS - 1; rest >>= 1) {
+        bucket++;
+    }
+    if (os_criticalStats.histogram[bucket] != UINT16_MAX) {
+        os_criticalStats.histogram[bucket]++;
+    }
+}
+
+/*!
+ * Returns the hold times of critical sections and ATOMIC blocks. Only the
+ * outermost section or block is timed. Blocks entered with interrupts already
+ * disabled (e.g. in an ISR) do not delay anything and are not timed either.
+ *
+ * \return A pointer to the statistics, which keep changing while processes run.
+ */
+const CriticalStats *os_getCriticalStats(void) {
+    return &os_criticalStats;
+}
+
+/*!
+ * Resets the hold times of critical sections and ATOMIC blocks
+ */
+void os_resetCriticalStats(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        os_criticalStats = (CriticalStats){0};
+    }
+}
+
+/*!
+ * Disables interrupts for an ATOMIC block. The block is timed if the interrupts were enabled before.
+ *
+ * \return The previous SREG.
+ */
+__attribute__((noinline)) uint8_t os_atomicBegin(void) {
+    const uint8_t sreg = SREG;
+    cli();
+    if (gbi(sreg, SREG_I)) {
+        os_atomicStart = os_systemTime_augment();
+        os_atomicPc = (uint16_t)__builtin_return_address(0);
+    }
+    return sreg;
+}
+
+/*!
+ * Ends an ATOMIC block by restoring the SREG saved by os_atomicBegin.
+ *
+ * \param sreg Points to the SREG saved by os_atomicBegin.
+ */
+void os_atomicEnd(const uint8_t *sreg) {
+    if (gbi(*sreg, SREG_I)) {
+        os_recordCriticalHold(os_atomicStart, os_atomicPc);
+    }
+    SREG = *sreg;
+}
+#endif
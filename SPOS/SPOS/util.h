@@ -12,14 +12,34 @@
 #ifndef _UTIL_H
 #define _UTIL_H
 
+#include "defines.h"
+
 #include <avr/pgmspace.h>
 #include <stdbool.h>
 #include <stdint.h>
 
 typedef uint32_t Time;
 
+//! CPU cycles counted by Timer 1, see os_ticks
+typedef uint32_t Ticks;
+
+//! Longest holds and hold time histogram of critical sections and ATOMIC blocks
+typedef struct {
+    //! Longest hold in os_systemTime_augment() ticks
+    Time maxHold;
+    //! Word address of the code that started the longest hold, as in the disassembly divided by two
+    uint16_t maxHoldPc;
+    //! Number of holds per duration, see CRITICAL_HISTOGRAM_BUCKETS
+    uint16_t histogram[CRITICAL_HISTOGRAM_BUCKETS];
+} CriticalStats;
+
 #define TC0_PRESCALER 256
 
+#define TC2_PRESCALER 1024
+
+//! Timer 1 runs without prescaler, so one tick is one CPU cycle
+#define TICKS_PER_MS (F_CPU / 1000ul)
+
 //----------------------------------------------------------------------------
 // Function headers
 //----------------------------------------------------------------------------
@@ -33,15 +53,58 @@ Time os_systemTime_coarse(void);
 //! Precise system time in ms
 Time os_systemTime_precise(void);
 
+//! Raw system time in Timer 0 overflows (approx. 3.3 ms each)
+Time os_systemTime_raw(void);
+
+//! System time in Timer 0 counts (approx. 13 us each)
+Time os_systemTime_augment(void);
+
+//! Converts milliseconds into Timer 0 overflows, rounding up
+Time os_systemTime_msToRaw(Time ms);
+
 //! Waits for some milliseconds
 void delayMs(Time ms);
 
+#if OS_TICKS
+//! Starts the cycle counter on Timer 1
+void os_ticks_init(void);
+
+//! Monotonic time in CPU cycles, wraps after 2^32 cycles (approx. 214 s)
+Ticks os_ticks(void);
+
+//! Converts ticks into microseconds
+uint32_t os_ticksToUs(Ticks ticks);
+
+//! Converts ticks into milliseconds
+Time os_ticksToMs(Ticks ticks);
+
+//! Converts milliseconds into ticks, the result wraps for more than approx. 214 s
+Ticks os_msToTicks(Time ms);
+#endif
+
 //! Simple assertion function that calls os_error if given expression is not true
 bool assertPstr(bool exp, const char *errormsg);
 
 //! Handy define to specify assert calls directly (without PSTR(..))
 #define assert(exp, errormsg) assertPstr(exp, PSTR(errormsg))
 
+#if OS_CRITICAL_STATS
+//! Books a hold of the scheduler that started at the given time
+void os_recordCriticalHold(Time start, uint16_t pc);
+
+//! Returns the hold times of critical sections and ATOMIC blocks
+const CriticalStats *os_getCriticalStats(void);
+
+//! Resets the hold times of critical sections and ATOMIC blocks
+void os_resetCriticalStats(void);
+
+//! Disables interrupts for an ATOMIC block and returns the previous SREG
+uint8_t os_atomicBegin(void);
+
+//! Restores the SREG saved by os_atomicBegin at the end of an ATOMIC block
+void os_atomicEnd(const uint8_t *sreg);
+#endif
+
 //----------------------------------------------------------------------------
 // Macros
 //----------------------------------------------------------------------------
@@ -65,22 +128,24 @@ bool assertPstr(bool exp, const char *errormsg);
 //----------------------------------------------------------------------------
 
 /*!
- * \brief Saves the register context on the stack
+ * \brief Saves the call-clobbered part of the register context on the stack
  *
- * All registers are saved to the proc's stack. Please note, that all processes
- * need to have their own stack, because we support preemptive scheduling.
- * So collisions with other stacks or the heap must be dealt with before making
- * this call, or data may be lost, resulting in weird effects.
+ * Pushes r31, SREG, r30 and r27..r18, r1 and r0, i.e. exactly the registers a
+ * called C function may destroy, and clears r1 afterwards. The scheduler runs
+ * its decision in between this and saveCalleeContext(), because the
+ * remaining registers are preserved by every C function anyway.
+ * Please note, that all processes need to have their own stack, because we
+ * support preemptive scheduling. So collisions with other stacks or the heap
+ * must be dealt with before making this call, or data may be lost, resulting
+ * in weird effects.
  */
-#define saveContext()                              \
+#define saveCallerContext()                        \
     __asm__ volatile(                              \
         "push  r31                           \n\t" \
         "in    r31, __SREG__                 \n\t" \
         "cli                                 \n\t" \
         "push  r31                           \n\t" \
         "push  r30                           \n\t" \
-        "push  r29                           \n\t" \
-        "push  r28                           \n\t" \
         "push  r27                           \n\t" \
         "push  r26                           \n\t" \
         "push  r25                           \n\t" \
@@ -91,6 +156,21 @@ bool assertPstr(bool exp, const char *errormsg);
         "push  r20                           \n\t" \
         "push  r19                           \n\t" \
         "push  r18                           \n\t" \
+        "push  r1                            \n\t" \
+        "clr   r1                            \n\t" \
+        "push  r0                            \n\t" \
+    );
+
+
+/*!
+ * \brief Saves the callee-saved part of the register context on the stack
+ *
+ * Pushes r29, r28 and r17..r2 on top of the frame left by saveCallerContext().
+ */
+#define saveCalleeContext()                        \
+    __asm__ volatile(                              \
+        "push  r29                           \n\t" \
+        "push  r28                           \n\t" \
         "push  r17                           \n\t" \
         "push  r16                           \n\t" \
         "push  r15                           \n\t" \
@@ -107,24 +187,29 @@ bool assertPstr(bool exp, const char *errormsg);
         "push  r4                            \n\t" \
         "push  r3                            \n\t" \
         "push  r2                            \n\t" \
-        "push  r1                            \n\t" \
-        "clr   r1                            \n\t" \
-        "push  r0                            \n\t" \
     );
 
 
 /*!
- * \brief Restores the register context on the stack
+ * \brief Saves the register context on the stack
  *
  * All registers are saved to the proc's stack. Please note, that all processes
  * need to have their own stack, because we support preemptive scheduling.
  * So collisions with other stacks or the heap must be dealt with before making
  * this call, or data may be lost, resulting in weird effects.
  */
-#define restoreContext()                           \
+#define saveContext()    \
+    saveCallerContext(); \
+    saveCalleeContext();
+
+
+/*!
+ * \brief Restores the callee-saved part of the register context from the stack
+ *
+ * Counterpart of saveCalleeContext().
+ */
+#define restoreCalleeContext()                     \
     __asm__ volatile(                              \
-        "pop  r0                             \n\t" \
-        "pop  r1                             \n\t" \
         "pop  r2                             \n\t" \
         "pop  r3                             \n\t" \
         "pop  r4                             \n\t" \
@@ -141,6 +226,21 @@ bool assertPstr(bool exp, const char *errormsg);
         "pop  r15                            \n\t" \
         "pop  r16                            \n\t" \
         "pop  r17                            \n\t" \
+        "pop  r28                            \n\t" \
+        "pop  r29                            \n\t" \
+    );
+
+
+/*!
+ * \brief Restores the call-clobbered part of the register context and returns from the interrupt
+ *
+ * Counterpart of saveCallerContext(). Used on its own, this resumes a process
+ * whose callee-saved registers were never touched.
+ */
+#define restoreCallerContext()                     \
+    __asm__ volatile(                              \
+        "pop  r0                             \n\t" \
+        "pop  r1                             \n\t" \
         "pop  r18                            \n\t" \
         "pop  r19                            \n\t" \
         "pop  r20                            \n\t" \
@@ -151,8 +251,6 @@ bool assertPstr(bool exp, const char *errormsg);
         "pop  r25                            \n\t" \
         "pop  r26                            \n\t" \
         "pop  r27                            \n\t" \
-        "pop  r28                            \n\t" \
-        "pop  r29                            \n\t" \
         "pop  r30                            \n\t" \
         "pop  r31                            \n\t" \
         "out  __SREG__, r31                  \n\t" \
@@ -161,11 +259,32 @@ bool assertPstr(bool exp, const char *errormsg);
     );
 
 
+/*!
+ * \brief Restores the register context on the stack
+ *
+ * All registers are restored from the proc's stack. Please note, that all processes
+ * need to have their own stack, because we support preemptive scheduling.
+ * So collisions with other stacks or the heap must be dealt with before making
+ * this call, or data may be lost, resulting in weird effects.
+ */
+#define restoreContext()    \
+    restoreCalleeContext(); \
+    restoreCallerContext();
+
+
 #define HALT \
     do {     \
     } while (1)
 
 // Used in testtasks
+#if OS_CRITICAL_STATS
+// Same as ATOMIC_BLOCK(ATOMIC_RESTORESTATE), but the block is timed
+#define ATOMIC                                                                                \
+    for (uint8_t os_atomicSreg __attribute__((cleanup(os_atomicEnd))) = os_atomicBegin(), \
+                 os_atomicOnce = 1;                                                        \
+         os_atomicOnce; os_atomicOnce = 0)
+#else
 #define ATOMIC ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#endif
 
 #endif
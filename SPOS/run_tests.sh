@@ -0,0 +1,104 @@
+#!/bin/bash
+# Builds the kernel once and runs test programs in parallel simulators.
+#
+# usage: bash run_tests.sh [-j JOBS] [TEST_PATH...]
+#
+# TEST_PATH is relative to ./tests like for build_run_sim.sh and defaults to
+# every v2 test. The kernel objects are built once into bin/tests/kernel and
+# reused by later runs as long as the sources are unchanged, every test is
+# linked and simulated in its own directory below bin/tests, which holds its
+# build.log, out.log and result afterwards.
+export ADDITIONAL_CFLAGS="-DCONFIRM_REQUIRED=0 -DCONTINOUS_INTEGRATION=1"
+export LD_LIBRARY_PATH=/usr/local/lib
+
+# 100x normal speed
+FREQUENCY=200000000000
+TIMEOUT=$((60 * 10))
+
+SIM=/utils/avrsimv2/installs/avrsimv2-2.3.5
+OUT_ROOT="$(pwd)/bin/tests"
+KERNEL_OUT=./bin/tests/kernel
+JOBS=$(nproc)
+
+while getopts "j:" opt; do
+    case $opt in
+        j) JOBS=$OPTARG ;;
+        *) echo "usage: $0 [-j JOBS] [TEST_PATH...]"; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+TESTS=("$@")
+if [ ${#TESTS[@]} -eq 0 ]; then
+    for test in ./tests/v2/*/progs.c; do
+        TESTS+=("${test#./tests/}")
+    done
+fi
+
+for test in "${TESTS[@]}"; do
+    if [ ! -f "./tests/$test" ]; then
+        echo "Error: Test program doesn't exist."
+        echo "./tests/$test"
+        exit 1
+    fi
+done
+
+# Directory of a test below OUT_ROOT, e.g. v2_4_Multiple for "v2/4 Multiple/progs.c", with every character but letters, digits and ._- replaced by _
+test_dir() {
+    echo "$OUT_ROOT/$(dirname "$1" | tr -c 'A-Za-z0-9._\n-' '_')"
+}
+
+run_test() {
+    local test=$1
+    local dir
+    dir=$(test_dir "$test")
+    rm -rf "$dir"
+    mkdir -p "$dir"
+
+    local start=$SECONDS
+    if ! make test-elf OUT="$KERNEL_OUT" TEST_PROGS="./tests/$test" TEST_OUT="$dir" > "$dir/build.log" 2>&1; then
+        echo "BUILD FAILED $((SECONDS - start))s" > "$dir/result"
+        return
+    fi
+    local built=$SECONDS
+
+    # The paths reach expect through the environment, so spaces or Tcl characters in them are not interpreted
+    TEST_DIR="$dir" SIM="$SIM" expect -c 'set timeout '"$TIMEOUT"'; log_user 0; log_file -noappend "$env(TEST_DIR)/out.log"; spawn "$env(SIM)/avrsimv2" -m atmega644 -f '"$FREQUENCY"' -b "$env(SIM)/boards/board_xml.so" -a "$env(SIM)/boards/psp_V2-V5.xml" "$env(TEST_DIR)/SPOS.elf"; expect "TEST PASSED" { close }' > /dev/null 2>&1
+
+    local status=FAILED
+    if grep -q "TEST PASSED" "$dir/out.log" 2> /dev/null; then
+        status=PASSED
+    fi
+    echo "$status build $((built - start))s simulation $((SECONDS - built))s" > "$dir/result"
+}
+
+start=$SECONDS
+
+# Built before the tests start, so their parallel links find the kernel up to date
+make kernel OUT="$KERNEL_OUT" -j"$JOBS" || exit 1
+
+for test in "${TESTS[@]}"; do
+    # Keep at most JOBS tests running
+    while [ "$(jobs -rp | wc -l)" -ge "$JOBS" ]; do
+        wait -n
+    done
+    run_test "$test" &
+done
+wait
+
+failed=0
+for test in "${TESTS[@]}"; do
+    dir=$(test_dir "$test")
+    result=$(cat "$dir/result" 2> /dev/null || echo "FAILED")
+    printf "%-50s %s\n" "$test" "$result"
+    case $result in
+        PASSED*) ;;
+        *)
+            failed=$((failed + 1))
+            echo "    see ${dir#$(pwd)/}/build.log and ${dir#$(pwd)/}/out.log"
+            ;;
+    esac
+done
+echo "${#TESTS[@]} tests, $failed failed, $((SECONDS - start))s"
+
+[ $failed -eq 0 ]
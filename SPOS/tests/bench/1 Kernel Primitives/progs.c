@@ -0,0 +1,165 @@
+//-------------------------------------------------
+//          Benchmark: Kernel Primitives
+//-------------------------------------------------
+//
+// Measures the cost of kernel primitives in CPU cycles with os_ticks().
+// Every result is shown as one screen of the form
+//   BENCH:<name>
+//   <cycles> cyc
+// where <cycles> is the average per operation with the measurement overhead
+// already subtracted. Primitives that do not switch processes are measured
+// with interrupts disabled, so the Timer 0 overflow, the LCD drain and the
+// scheduler are not counted into them. The CI job extracts these lines from
+// the simulator log and compares them with the previous run.
+
+#include "lcd.h"
+#include "os_core.h"
+#include "os_scheduler.h"
+#include "util.h"
+
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <util/atomic.h>
+
+#if VERSUCH < 2
+#error "Please fix the VERSUCH-define"
+#endif
+
+#if !OS_TICKS
+#error "The benchmarks need the cycle counter, see OS_TICKS"
+#endif
+
+#ifndef WRITE
+#define WRITE(str) lcd_writeProgString(PSTR(str))
+#endif
+#define TEST_PASSED                    \
+    do {                               \
+        ATOMIC {                       \
+            lcd_clear();               \
+            WRITE("  TEST PASSED   "); \
+            lcd_flush();               \
+        }                              \
+    } while (0)
+
+//! Number of times every primitive is executed per measurement
+#define BENCH_ITERATIONS 100
+
+//! Measurement overhead of measure(), with and without interrupts, measured with an empty primitive
+static Ticks overhead[2];
+
+//! Shows a result on the LCD in the format described at the top
+static void report(const char *name, Ticks cycles) {
+    lcd_clear();
+    WRITE("BENCH:");
+    lcd_writeProgString(name);
+    lcd_line2();
+    printf("%lu cyc", (unsigned long)cycles);
+    lcd_flush();
+    delayMs(DEFAULT_OUTPUT_DELAY * 4);
+}
+
+/*!
+ * Runs a primitive BENCH_ITERATIONS times and sums up the cycles of the calls.
+ * Never inlined or specialized, so the empty primitive measured for the
+ * overhead goes through the same loop and indirect call as every other one.
+ *
+ * \param body The primitive to measure.
+ * \param atomic Whether the calls run with interrupts disabled.
+ * \return The cycles of all calls including the measurement overhead.
+ */
+static Ticks __attribute__((noinline, noclone)) measure(void (*body)(void), bool atomic) {
+    Ticks cycles = 0;
+    for (uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+        // Measured call by call, so the cycle counter never overflows twice while interrupts are disabled
+        const uint8_t sreg = SREG;
+        if (atomic) {
+            cli();
+        }
+        const Ticks start = os_ticks();
+        body();
+        cycles += os_ticks() - start;
+        SREG = sreg;
+    }
+    return cycles;
+}
+
+/*!
+ * Runs a primitive BENCH_ITERATIONS times and reports the cycles per operation.
+ *
+ * \param name Name of the benchmark in program memory, at most 10 characters.
+ * \param body The primitive to measure.
+ * \param operations Number of operations one call of body amounts to.
+ * \param atomic Whether the calls run with interrupts disabled, false for primitives that switch processes.
+ */
+static void bench(const char *name, void (*body)(void), uint8_t operations, bool atomic) {
+    Ticks cycles = measure(body, atomic);
+    cycles = cycles > overhead[atomic] ? cycles - overhead[atomic] : 0;
+    report(name, cycles / ((uint32_t)BENCH_ITERATIONS * operations));
+}
+
+static void noop(void) {
+}
+
+static void critical(void) {
+    os_enterCriticalSection();
+    os_leaveCriticalSection();
+}
+
+static void writeChar(void) {
+    lcd_writeChar('#');
+}
+
+static void noopProgram(void) {
+}
+
+static void execKill(void) {
+    os_kill(os_exec(noopProgram, DEFAULT_PRIORITY));
+}
+
+static void schedule(void) {
+    TIMER2_COMPA_vect();
+}
+
+static void yieldingProgram(void) {
+    while (1) {
+        os_yield();
+    }
+}
+
+//! Measures the scheduler decision of a strategy while only main is ready
+static void benchStrategy(const char *name, SchedulingStrategy strategy) {
+    os_setSchedulingStrategy(strategy);
+    // The ISR returns with reti, which enables interrupts anyway
+    bench(name, schedule, 1, false);
+}
+
+REGISTER_AUTOSTART(main_program)
+void main_program(void) {
+    overhead[false] = measure(noop, false);
+    overhead[true] = measure(noop, true);
+
+    bench(PSTR("critical"), critical, 1, true);
+    bench(PSTR("lcdchar"), writeChar, 1, true);
+    bench(PSTR("exec_kill"), execKill, 1, true);
+
+    // Every yield of main is answered by one of the partner, so each call switches twice
+    os_setSchedulingStrategy(OS_SS_EVEN);
+    ProcessID partner = os_exec(yieldingProgram, DEFAULT_PRIORITY);
+    bench(PSTR("switch"), os_yield, 2, false);
+    os_kill(partner);
+
+    benchStrategy(PSTR("sched_even"), OS_SS_EVEN);
+    benchStrategy(PSTR("sched_rand"), OS_SS_RANDOM);
+    benchStrategy(PSTR("sched_rr"), OS_SS_ROUND_ROBIN);
+    benchStrategy(PSTR("sched_ia"), OS_SS_INACTIVE_AGING);
+    benchStrategy(PSTR("sched_rtc"), OS_SS_RUN_TO_COMPLETION);
+    benchStrategy(PSTR("sched_edf"), OS_SS_EDF);
+    benchStrategy(PSTR("sched_rm"), OS_SS_RATE_MONOTONIC);
+    os_setSchedulingStrategy(OS_SS_EVEN);
+
+    TEST_PASSED;
+    HALT;
+}
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Compares the results of the kernel benchmarks with a previous run.
+
+Both files are simulator logs of tests/bench or the lines the CI job extracts
+from them with grep, every result is the screen "BENCH:<name>" followed by
+"<cycles> cyc". For every benchmark the cycles of both runs and the change are
+printed, benchmarks that only exist in one of the runs are marked as new or
+removed. The comparison only reports, it never fails:
+
+    grep -A1 "BENCH:" bin/tests/bench_*/out.log > bench.txt
+    python3 tools/bench_compare.py baseline.txt bench.txt
+"""
+
+import argparse
+import os
+import re
+import sys
+
+NAME = re.compile(r"BENCH:(\S+)")
+CYCLES = re.compile(r"(\d+) cyc")
+
+
+def parse(lines):
+    results = {}
+    name = None
+    for line in lines:
+        match = NAME.search(line)
+        if match:
+            name = match.group(1)
+            continue
+        match = CYCLES.search(line)
+        if match and name is not None:
+            results[name] = int(match.group(1))
+            name = None
+    return results
+
+
+def table(baseline, current, out):
+    print("%-12s %10s %10s %10s %8s" % ("benchmark", "baseline", "current", "delta", "change"), file=out)
+    for name in list(current) + [name for name in baseline if name not in current]:
+        if name not in baseline:
+            print("%-12s %10s %10d %10s %8s" % (name, "-", current[name], "-", "new"), file=out)
+        elif name not in current:
+            print("%-12s %10d %10s %10s %8s" % (name, baseline[name], "-", "-", "removed"), file=out)
+        else:
+            delta = current[name] - baseline[name]
+            change = "%+.1f%%" % (100.0 * delta / baseline[name]) if baseline[name] else "-"
+            print("%-12s %10d %10d %+10d %8s" % (name, baseline[name], current[name], delta, change), file=out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline", help="results of the previous run, a missing file is treated as empty")
+    parser.add_argument("current", help="results of this run")
+    parser.add_argument("--summary", default=os.environ.get("GITHUB_STEP_SUMMARY"), help="file the table is appended to as markdown (default: $GITHUB_STEP_SUMMARY)")
+    args = parser.parse_args()
+
+    baseline = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as log:
+            baseline = parse(log)
+    else:
+        print("No baseline at %s, every benchmark is new" % args.baseline)
+    with open(args.current) as log:
+        current = parse(log)
+
+    table(baseline, current, sys.stdout)
+    if args.summary:
+        with open(args.summary, "a") as summary:
+            print("### Kernel benchmarks\n\n```", file=summary)
+            table(baseline, current, summary)
+            print("```", file=summary)
+
+
+if __name__ == "__main__":
+    main()
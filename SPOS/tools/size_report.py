@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Summarizes the disassembly of an SPOS build per function.
+
+For every function the flash size, the number of instructions and a cycle
+estimate are printed, largest function first, followed by the interrupt
+vectors and the scheduler hot path. The cycle estimate is the sum over all
+instructions of the function as if it ran straight through once with every
+branch not taken and every skip not skipping, so it is a rough measure for
+comparing builds, not a worst case execution time:
+
+    make release-lto
+    avr-objdump -d SPOS.elf > dis.txt
+    python3 tools/size_report.py dis.txt
+"""
+
+import argparse
+import re
+import sys
+
+# Cycles on the ATmega644 (16 bit program counter), see the AVR instruction set manual
+CYCLES = {
+    "adiw": 2, "sbiw": 2, "mul": 2, "muls": 2, "mulsu": 2, "fmul": 2, "fmuls": 2, "fmulsu": 2,
+    "rjmp": 2, "ijmp": 2, "jmp": 3, "rcall": 3, "icall": 3, "call": 4, "ret": 4, "reti": 4,
+    "ld": 2, "ldd": 2, "lds": 2, "st": 2, "std": 2, "sts": 2, "push": 2, "pop": 2,
+    "lpm": 3, "elpm": 3, "spm": 4, "sbi": 2, "cbi": 2,
+}
+
+# Functions that run on every scheduler invocation, __vector_9 is TIMER2_COMPA_vect
+HOT_PATH = ("__vector_9", "os_scheduleNext", "os_dispatch")
+
+FUNCTION = re.compile(r"^([0-9a-f]+) <([^>]+)>:$")
+INSTRUCTION = re.compile(r"^\s*([0-9a-f]+):\t((?:[0-9a-f]{2} )+)\s*\t(\S+)")
+
+
+def parse(lines):
+    functions = {}
+    current = None
+    for line in lines:
+        match = FUNCTION.match(line)
+        if match:
+            current = functions.setdefault(match.group(2), {"size": 0, "instructions": 0, "cycles": 0})
+            continue
+        match = INSTRUCTION.match(line)
+        if match and current is not None:
+            # .word lines are data, e.g. the vector table padding
+            if match.group(3).startswith("."):
+                continue
+            current["size"] += len(match.group(2).split())
+            current["instructions"] += 1
+            current["cycles"] += CYCLES.get(match.group(3), 1)
+    return functions
+
+
+def table(title, names, functions, out):
+    print(title, file=out)
+    print("%8s %8s %8s  %s" % ("bytes", "instr", "cycles", "function"), file=out)
+    for name in names:
+        function = functions[name]
+        print("%8d %8d %8d  %s" % (function["size"], function["instructions"], function["cycles"], name), file=out)
+    print(file=out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("disassembly", nargs="?", help="output of avr-objdump -d, stdin if omitted")
+    parser.add_argument("--top", type=int, default=40, help="number of functions to list by size (default: %(default)s)")
+    args = parser.parse_args()
+
+    if args.disassembly:
+        with open(args.disassembly) as disassembly:
+            functions = parse(disassembly)
+    else:
+        functions = parse(sys.stdin)
+
+    by_size = sorted(functions, key=lambda name: functions[name]["size"], reverse=True)
+    total = sum(function["size"] for function in functions.values())
+    table("Largest functions (%d bytes of code in total)" % total, by_size[:args.top], functions, sys.stdout)
+
+    vectors = sorted((name for name in functions if name[9:].isdigit() and name.startswith("__vector_")), key=lambda name: int(name[9:]))
+    table("Interrupt vectors", vectors, functions, sys.stdout)
+
+    table("Scheduler hot path", [name for name in HOT_PATH if name in functions], functions, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
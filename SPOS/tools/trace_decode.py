@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""Decodes the binary kernel trace of SPOS (see SPOS/os_trace.h) into a timeline.
+
+The trace is read from a file or from stdin, e.g. a capture of USART0 at
+TRACE_BAUD 8N1 that started before the board was reset:
+
+    stty -F /dev/ttyUSB0 115200 raw
+    cat /dev/ttyUSB0 > trace.bin
+    python3 tools/trace_decode.py trace.bin
+"""
+
+import argparse
+import struct
+import sys
+
+# Must match TraceEvent in os_trace.h
+TRACE_TIME = 0
+TRACE_OVERRUN = 1
+TRACE_SWITCH = 2
+TRACE_EXEC = 3
+TRACE_KILL = 4
+TRACE_CRITICAL_ENTER = 5
+TRACE_CRITICAL_LEAVE = 6
+TRACE_BLOCK = 7
+TRACE_UNBLOCK = 8
+
+
+def describe(event, pid, arg):
+    if event == TRACE_OVERRUN:
+        return "overrun      %s%d records dropped" % (">=" if arg == 255 else "", arg)
+    if event == TRACE_SWITCH:
+        return "switch       #%d -> #%d" % (pid, arg)
+    if event == TRACE_EXEC:
+        return "exec         #%d priority %d" % (pid, arg)
+    if event == TRACE_KILL:
+        return "kill         #%d by #%d" % (pid, arg)
+    if event == TRACE_CRITICAL_ENTER:
+        return "critical     #%d enter" % pid
+    if event == TRACE_CRITICAL_LEAVE:
+        return "critical     #%d leave" % pid
+    if event == TRACE_BLOCK:
+        return "block        #%d" % pid
+    if event == TRACE_UNBLOCK:
+        return "unblock      #%d" % pid
+    return "unknown %d   #%d arg %d" % (event, pid, arg)
+
+
+def decode(data, cycles_per_unit, cycles_per_us, out):
+    epoch = 0
+    critical_since = {}
+    for offset in range(0, len(data) - len(data) % 4, 4):
+        time, type_pid, arg = struct.unpack_from("<HBB", data, offset)
+        event, pid = type_pid >> 4, type_pid & 0x0F
+        if event == TRACE_TIME:
+            epoch = time
+            continue
+        cycles = ((epoch << 16) | time) * cycles_per_unit
+        line = "%14.1f us  %s" % (cycles / cycles_per_us, describe(event, pid, arg))
+        # Only the outermost critical section is traced, its hold time is shown with the leave
+        if event == TRACE_CRITICAL_ENTER:
+            critical_since[pid] = cycles
+        elif event == TRACE_CRITICAL_LEAVE and pid in critical_since:
+            line += " after %.1f us" % ((cycles - critical_since.pop(pid)) / cycles_per_us)
+        print(line, file=out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("trace", nargs="?", help="binary trace, stdin if omitted")
+    parser.add_argument("--f-cpu", type=int, default=20000000, help="F_CPU of the build (default: %(default)s)")
+    parser.add_argument("--shift", type=int, default=4, help="TRACE_TIME_SHIFT of the build (default: %(default)s)")
+    args = parser.parse_args()
+
+    if args.trace:
+        with open(args.trace, "rb") as trace:
+            data = trace.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    decode(data, 1 << args.shift, args.f_cpu / 1000000, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()